@@ -16,11 +16,12 @@
 # rewrite with AT&T syntax by falcon <wuzhangjin@gmail.com> at 081012
 #
 # SYS_SIZE is the number of clicks (16 bytes) to be loaded.
-# 0x3000 is 0x30000 bytes = 196kB, more than enough for current
-# versions of linux
+# 0x4800 is 0x48000 bytes = 288kB, enough for the SMP kernel
 #
-# SYSSIZE是要加载的节数（16个字节为1节）0x3000*16也就是192KB的大小，
-# 对于当前的内核来说已经足够了
+# SYSSIZE是要加载的节数（16个字节为1节）0x4800*16也就是288KB的大小，
+# SMP内核已经超过了原来的192KB
+# 按磁道读取会多读最多一个磁道，软盘映像中RAMDISK_START(320KB)之前都是内核和0，
+# 多读的部分不会把虚拟盘的数据读到内核的bss中
 # 80386在启动后处于8086,8086内存分段最大可寻址1MB的内存，这1MB的内存排列如下：
 # 0x00000 - 0x9FFFF 640KB， 最低1KB位BIOS中断向量表
 # 0xA0000 - 0xB7FFF 外围设备
@@ -28,7 +29,7 @@
 # 0xC0000 - 0xEFFFF 外围设备
 # 0xF0000 - 0xFFFFF BIOS
 #
-	.equ SYSSIZE, 0x3000
+	.equ SYSSIZE, 0x4800
 #
 #	bootsect.s		(C) 1991 Linus Torvalds
 #
@@ -209,8 +210,8 @@ ok_load_setup:
 
 # 
 # 读取SYS模块，存放在地址0x10000（64K）开始的地方，
-# 根据前面的SYSSIZE定义我们知道一共读取0x3000*16个字节也就是192KB的内容
-# 对于我们来说已经够了，我们可以计算出当前的最大地址为64 + 192 = 256KB，
+# 根据前面的SYSSIZE定义我们知道一共读取0x4800*16个字节也就是288KB的内容
+# 我们可以计算出当前的最大地址为64 + 288 = 352KB，
 # 不能覆盖到bootsect和setup模块的起始地址
 # ok, we've written the message, now
 # we want to load the system (at 0x10000)
@@ -248,7 +249,7 @@ root_defined:
 # 目前，
 # bootsect在0x90000地址处共512字节
 # setup在0x90200地址处共2KB
-# system模块在0x10000(64KB)地址处共192KB字节
+# system模块在0x10000(64KB)地址处共288KB字节
 # 以上都在实模式的1MB访问空间内
 #
 # after that (everyting loaded), we jump to
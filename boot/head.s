@@ -11,6 +11,9 @@
 #
 .text
 .globl startup_32,idt,gdt,swapper_pg_dir,tmp_floppy_area,floppy_track_buffer
+.ifdef CONFIG_SMP
+.globl idt_descr,gdt_descr		# trampoline.s中使用
+.endif
 
 #
 # swapper_pg_dir是页目录的地址，页目录地址在0x00000000处
@@ -389,8 +392,16 @@ gdt_descr:
 .align 4
 gdt:
 	.quad 0x0000000000000000	# NULL descriptor
+.ifdef CONFIG_SMP
+#
+# SMP内核通过0xFFC00000访问APIC，偏移为0x3FC00000，段长度扩展为1GB
+#
+	.quad 0xc0c39a000000ffff	# 1Gb at 0xC0000000
+	.quad 0xc0c392000000ffff	# 1Gb at 0xC0000000
+.else
 	.quad 0xc0c09a0000000fff	# 16Mb at 0xC0000000
 	.quad 0xc0c0920000000fff	# 16Mb at 0xC0000000
+.endif
 	.quad 0x0000000000000000	# TEMPORARY - don't use
 	.fill 252,8,0			    # space for LDT's and TSS
 
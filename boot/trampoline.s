@@ -0,0 +1,68 @@
+/*
+ *  linux/boot/trampoline.s
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#
+# trampoline.s AP(应用处理器)的启动代码，只在SMP内核中链接
+#
+# BSP发送STARTUP IPI时的向量为trampoline的物理地址>>12，
+# AP在实模式下从CS=trampoline>>4，IP=0开始执行，因此trampoline必须4KB对齐
+# 并且在1MB以下，内核从物理地址0开始并且链接地址为0，所以标号的值就是物理地址
+#
+# 1. 实模式下加载一个临时的平坦GDT，进入保护模式
+# 2. 使用swapper_pg_dir开启分页，页目录第0项是0~4MB的对等映射
+# 3. 加载内核的gdt和idt，跳转到基地址为0xC0000000的内核代码段
+# 4. 使用BSP准备好的ap_stack_top作为栈，调用start_secondary
+#
+
+.globl trampoline
+
+.text
+.align 4096
+.code16
+trampoline:
+	cli
+	movw %cs,%ax
+	movw %ax,%ds
+	lgdtl tr_gdt_descr - trampoline	# 临时GDT，ds相对于trampoline
+	movl %cr0,%eax
+	orl $1,%eax
+	movl %eax,%cr0			# PE
+	ljmpl $0x08,$tr_protected	# 平坦代码段，偏移就是物理地址
+
+.code32
+tr_protected:
+	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	mov %ax,%ss
+	xorl %eax,%eax			# swapper_pg_dir is at 0x0000
+	movl %eax,%cr3
+	movl %cr0,%eax
+	orl $0x80000013,%eax		# PG, ET, MP, PE，和head.s中一样
+	movl %eax,%cr0
+	jmp 1f
+1:	lgdt gdt_descr			# 此时线性地址和物理地址相同
+	lidt idt_descr
+	ljmp $0x08,$2f			# 内核代码段
+2:	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	mov %ax,%fs
+	mov %ax,%gs
+	mov %ax,%ss
+	movl ap_stack_top,%esp
+	cld
+	call start_secondary
+3:	jmp 3b
+
+.align 8
+tr_gdt:
+	.quad 0x0000000000000000	# NULL descriptor
+	.quad 0x00cf9a000000ffff	# 4GB code at 0x00000000
+	.quad 0x00cf92000000ffff	# 4GB data at 0x00000000
+tr_gdt_descr:
+	.word 3*8-1
+	.long tr_gdt
@@ -56,6 +56,84 @@ __asm__ __volatile__ ("cld\n" \
 	:"=c" (__res):"c" (0),"S" (addr)); \
 __res;})
 
+/*
+ * 文件预分配窗口的块数
+ */
+#define PREALLOC_BLOCKS	8
+
+/*
+ * 逻辑块位图中有效的位数，bit0保留，位j对应的块号为j + s_firstdatazone - 1
+ */
+static int zmap_bits(struct super_block * sb)
+{
+	int n = sb->s_nzones - sb->s_firstdatazone + 1;
+
+	if (n > sb->s_zmap_blocks * 8192)
+		n = sb->s_zmap_blocks * 8192;
+	return n;
+}
+
+/*
+ * 统计位图中[1, nbits)范围内为0的位数，整个字都被使用时一次跳过32位
+ */
+static unsigned long count_zero(struct buffer_head ** map, int nbits)
+{
+	unsigned long * p, count = 0;
+	int nr = 1;
+
+	while (nr < nbits) {
+		p = (unsigned long *) map[nr >> 13]->b_data + ((nr & 8191) >> 5);
+		if (!(nr & 31) && nr + 32 <= nbits && *p == 0xffffffff) {
+			nr += 32;
+			continue;
+		}
+		if (!((*p >> (nr & 31)) & 1))
+			count++;
+		nr++;
+	}
+	return count;
+}
+
+/*
+ * 安装时统计空闲块数和空闲i节点数，以后在分配和释放时增减，
+ * 不需要每次扫描位图，计数为0时分配直接失败
+ */
+void count_free(struct super_block * sb)
+{
+	int n = sb->s_ninodes + 1;
+
+	if (n > sb->s_imap_blocks * 8192)
+		n = sb->s_imap_blocks * 8192;
+	sb->s_free_zones = count_zero(sb->s_zmap, zmap_bits(sb));
+	sb->s_free_inodes = count_zero(sb->s_imap, n);
+}
+
+/*
+ * 从位start开始向后查找为0的位，到结尾后再从头找到start，返回0表示没有
+ * 整个字都被使用时一次跳过32位
+ */
+static int find_zero_from(struct super_block * sb, int start, int nbits)
+{
+	unsigned long * p;
+	int nr = start, end = nbits, pass;
+
+	for (pass = 0 ; pass < 2 ; pass++) {
+		while (nr < end) {
+			p = (unsigned long *) sb->s_zmap[nr >> 13]->b_data + ((nr & 8191) >> 5);
+			if (!(nr & 31) && *p == 0xffffffff) {
+				nr += 32;
+				continue;
+			}
+			if (!((*p >> (nr & 31)) & 1))
+				return nr;
+			nr++;
+		}
+		nr = 1;
+		end = start;
+	}
+	return 0;
+}
+
 /*
  * 释放设备dev上数据区中的逻辑块block
  * 将逻辑快位图block设置为0，并将此block所在位图的高速缓存设置为已修改
@@ -118,6 +196,7 @@ void free_block(int dev, int block)
 		printk("block (%04x:%d) ", dev,block + sb->s_firstdatazone-1);
 		panic("free_block: bit already cleared");
 	}
+	sb->s_free_zones++;
 	/*
 	 * 逻辑块位图本身在一个缓冲区中
 	 * 设置相应逻辑块位图所在缓冲区已修改标志
@@ -128,9 +207,11 @@ void free_block(int dev, int block)
 	sb->s_zmap[block/8192]->b_dirt = 1;
 }
 
+static void zero_block(int dev, int j);
+
 /*
  * 向设备dev申请一个逻辑块，返回实际逻辑块号
- * 在逻辑块位图中找到一个为0的位索引为j
+ * 从goal对应的位开始向后查找为0的位j，goal不在数据区时从头开始
  * 在逻辑块位图中将位j设置为1
  * 设置逻辑块位图高速缓存为已修改
  * 根据j计算实际块的索引
@@ -138,11 +219,11 @@ void free_block(int dev, int block)
  * 设置告诉缓存已修改
  * 
  */
-int new_block(int dev)
+int new_block(int dev, int goal)
 {
 	struct buffer_head * bh;
 	struct super_block * sb;
-	int i, j;
+	int j, nbits;
 
 	/*
 	 * 获取超级块
@@ -152,22 +233,24 @@ int new_block(int dev)
 		panic("trying to get new block from nonexistant device");
 	
 	/*
-	 * 遍历逻辑块位图，找到第一个为0的bit，bit0是保留的
+	 * 查找为0的bit，bit0是保留的
 	 *
 	 */
-	j = 8192;
-	for (i = 0; i < 8; i++)
-		if ((bh = sb->s_zmap[i]))
-			if ((j = find_first_zero(bh->b_data)) < 8192)
-				break;
-	if (i >= 8 || !bh || j >= 8192)
+	if (!sb->s_free_zones)
 		return 0;
+	nbits = zmap_bits(sb);
+	j = goal - sb->s_firstdatazone + 1;
+	if (j < 1 || j >= nbits)
+		j = 1;
+	if (!(j = find_zero_from(sb, j, nbits)))
+		return 0;
+	bh = sb->s_zmap[j >> 13];
 	/*
 	 * 将逻辑块bit位置位，如果原来就是1则panic
 	 *
 	 *
 	 */
-	if (set_bit(j, bh->b_data))
+	if (set_bit(j & 8191, bh->b_data))
 		panic("new_block: bit already set");
 	/*
 	 * 逻辑块位图本身在一个缓冲区中
@@ -176,11 +259,12 @@ int new_block(int dev)
 	 *
 	 */
 	bh->b_dirt = 1;
+	sb->s_free_zones--;
 	/*
 	 *
-	 * j += i*8192 + sb->s_firstdatazone - 1 表达式计算block的值
-	 * 我们假设i为0，j为1，则
-	 * 1 += 0*8192 + sb->s_firstdatazone - 1
+	 * j += sb->s_firstdatazone - 1 表达式计算block的值
+	 * 我们假设j为1，则
+	 * 1 += sb->s_firstdatazone - 1
 	 * 表达式的值为sb->s_firstdatazone，也就是第一个数据区的块
 	 * 由此我们可见逻辑块位图bit1对应的数据区块是第一个块，bit0保留
 	 *
@@ -188,9 +272,18 @@ int new_block(int dev)
 	 *
 	 *
 	 */
-	j += i*8192 + sb->s_firstdatazone - 1;
-	if (j >= sb->s_nzones)
-		return 0;
+	j += sb->s_firstdatazone - 1;
+	zero_block(dev, j);
+	return j;
+}
+
+/*
+ * 获取块的缓冲区并清零，设置更新标志和已修改标志
+ */
+static void zero_block(int dev, int j)
+{
+	struct buffer_head * bh;
+
 	/*
 	 * j为block的值
 	 * 获取该设备的该新逻辑块数据，如果失败则panic
@@ -213,7 +306,65 @@ int new_block(int dev)
 	bh->b_uptodate = 1;
 	bh->b_dirt = 1;
 	brelse(bh);
-	return j;
+}
+
+/*
+ * 在位图中预留块，块已经被使用时返回0
+ */
+static int reserve_block(struct super_block * sb, int block)
+{
+	int j = block - sb->s_firstdatazone + 1;
+
+	if (j >= zmap_bits(sb) || set_bit(j & 8191, sb->s_zmap[j >> 13]->b_data))
+		return 0;
+	sb->s_zmap[j >> 13]->b_dirt = 1;
+	sb->s_free_zones--;
+	return 1;
+}
+
+/*
+ * 释放文件的预分配窗口，在关闭文件(最后一次iput)和截断时调用
+ */
+void discard_prealloc(struct m_inode * inode)
+{
+	while (inode->i_prealloc_count) {
+		inode->i_prealloc_count--;
+		free_block(inode->i_dev, inode->i_prealloc_block++);
+	}
+}
+
+/*
+ * 为文件分配一个逻辑块，goal一般是文件前一块的下一块
+ * 顺序写时goal就是预分配窗口的第一块，直接使用，
+ * 否则释放窗口，从goal开始查找空闲块，并预留后面连续空闲的块
+ * goal为0时从和i节点号成比例的位置开始，不同的文件分散在整个数据区
+ * 预留的块在位图中已经置位，没有释放时系统崩溃的话这些块会丢失
+ */
+int new_file_block(struct m_inode * inode, int goal)
+{
+	struct super_block * sb;
+	int block, i;
+
+	if (inode->i_prealloc_count && inode->i_prealloc_block == goal) {
+		inode->i_prealloc_block++;
+		inode->i_prealloc_count--;
+		zero_block(inode->i_dev, goal);
+		return goal;
+	}
+	discard_prealloc(inode);
+	if (!(sb = get_super(inode->i_dev)))
+		panic("trying to get new block from nonexistant device");
+	if (goal < sb->s_firstdatazone || goal >= sb->s_nzones)
+		goal = sb->s_firstdatazone + (long) (inode->i_num - 1) *
+			(sb->s_nzones - sb->s_firstdatazone) / sb->s_ninodes;
+	if (!(block = new_block(inode->i_dev, goal)))
+		return 0;
+	for (i = 1 ; i <= PREALLOC_BLOCKS ; i++)
+		if (block + i >= sb->s_nzones || !reserve_block(sb, block + i))
+			break;
+	inode->i_prealloc_block = block + 1;
+	inode->i_prealloc_count = i - 1;
+	return block;
 }
 
 /*
@@ -230,7 +381,7 @@ void free_inode(struct m_inode * inode)
 	 * 如果i节点的设备号字段为0，说明该节点无用
 	 */
 	if (!inode->i_dev) {
-		memset(inode, 0, sizeof(*inode));
+		clear_inode(inode);
 		return;
 	}
 	/*
@@ -272,13 +423,15 @@ void free_inode(struct m_inode * inode)
 	 */
 	if (clear_bit(inode->i_num&8191, bh->b_data))
 		printk("free_inode: bit already cleared.\n\r");
+	else
+		sb->s_free_inodes++;
 	/*
 	 * 设置已修改标志，并清空该i节点所占的内存
 	 * 数据时机刷入磁盘
 	 *
 	 */
 	bh->b_dirt = 1;
-	memset(inode, 0, sizeof(*inode));
+	clear_inode(inode);
 }
 
 /*
@@ -302,6 +455,10 @@ struct m_inode * new_inode(int dev)
 	 */
 	if (!(sb = get_super(dev)))
 		panic("new_inode with unknown device");
+	if (!sb->s_free_inodes) {
+		iput(inode);
+		return NULL;
+	}
 	/*
 	 * 寻找第一个为0的i节点的bit
 	 */
@@ -319,6 +476,7 @@ struct m_inode * new_inode(int dev)
 	 */
 	if (set_bit(j, bh->b_data))
 		panic("new_inode: bit already set");
+	sb->s_free_inodes--;
 	/*
 	 * 设置该i节点位图所在的高速缓存已修改标志
 	 * 后续该位置会被刷入磁盘
@@ -340,6 +498,7 @@ struct m_inode * new_inode(int dev)
 	 */
 	inode->i_num = j + i*8192;
 	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
+	hash_new_inode(inode);
 	return inode;
 }
 
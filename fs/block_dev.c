@@ -33,11 +33,14 @@ int block_write(int dev, long * pos, char * buf, int count)
 			return written?written:-EIO;
 		p = offset + bh->b_data;
 		offset = 0;
+		if (copy_from_user(p, buf, chars)) {
+			brelse(bh);
+			return written?written:-EFAULT;
+		}
 		*pos += chars;
 		written += chars;
 		count -= chars;
-		while (chars-->0)
-			*(p++) = get_fs_byte(buf++);
+		buf += chars;
 		bh->b_dirt = 1;
 		brelse(bh);
 	}
@@ -62,11 +65,14 @@ int block_read(int dev, unsigned long * pos, char * buf, int count)
 		block++;
 		p = offset + bh->b_data;
 		offset = 0;
+		if (copy_to_user(buf, p, chars)) {
+			brelse(bh);
+			return read?read:-EFAULT;
+		}
 		*pos += chars;
 		read += chars;
 		count -= chars;
-		while (chars-->0)
-			put_fs_byte(*(p++),buf++);
+		buf += chars;
 		brelse(bh);
 	}
 	return read;
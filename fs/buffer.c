@@ -19,12 +19,17 @@
  */
 
 #include <stdarg.h>
+#include <errno.h>
  
 #include <linux/config.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/time.h>
+#include <linux/iostat.h>
 #include <asm/system.h>
 #include <asm/io.h>
+#include <asm/segment.h>
+#include <asm/spinlock.h>
 
 /*
  * end由链接程序生成，表示内核最后面的地址，是一个NOTYPE类型的符号
@@ -36,11 +41,57 @@ extern void put_super(int);
 extern void invalidate_inodes(int);
 
 struct buffer_head * start_buffer = (struct buffer_head *) &end;
-struct buffer_head * hash_table[NR_HASH];
-static struct buffer_head * free_list;
+/*
+ * 哈希表在buffer_init中按缓冲区的个数分配，放在缓冲区头的前面
+ * 大小是2的hash_bits次方，不小于缓冲区的个数
+ */
+static struct buffer_head ** hash_table;
+static int hash_bits;
+static unsigned long hash_lookups = 0, hash_probes = 0;
+/*
+ * 通过iostat系统调用读取
+ */
+struct cache_stat cache_stats = { 0, };
 static struct task_struct * buffer_wait = NULL;
+/*
+ * 没有使用的缓冲区按是否修改分别放在两个双向循环链表中，表头是最久没有使用的
+ * 使用中的缓冲区也在链表中，brelse时移到对应链表的尾部
+ * 修改标志由调用者直接设置，链表只在brelse和查找时调整，所以可能暂时不一致
+ */
+#define BUF_CLEAN	0
+#define BUF_DIRTY	1
+
+static struct buffer_head * lru_list[2] = { NULL, NULL };
+static int nr_list[2] = { 0, 0 };
+/*
+ * 保护hash表和lru_list，单处理器时为空
+ */
+static spinlock_t buffer_lock = SPIN_LOCK_UNLOCKED;
 int NR_BUFFERS = 0;
 
+/*
+ * 回写进程的参数，可以在Makefile.head中配置，运行时通过bdflush系统调用修改
+ * age 		缓冲区修改后经过age个滴答写回
+ * interval 	回写进程每隔interval个滴答运行一次
+ * ratio 	脏缓冲区超过全部缓冲区的ratio%时唤醒回写进程，写的进程也要等待写回
+ */
+#ifndef BDFLUSH_AGE
+#define BDFLUSH_AGE	(30*HZ)
+#endif
+#ifndef BDFLUSH_INTERVAL
+#define BDFLUSH_INTERVAL	(5*HZ)
+#endif
+#ifndef BDFLUSH_RATIO
+#define BDFLUSH_RATIO	40
+#endif
+#define NR_BDF_PARAM	3
+
+static long bdf_prm[NR_BDF_PARAM] = { BDFLUSH_AGE, BDFLUSH_INTERVAL, BDFLUSH_RATIO };
+static long bdf_min[NR_BDF_PARAM] = { 0, 1, 1 };
+static long bdf_max[NR_BDF_PARAM] = { 600*HZ, 60*HZ, 100 };
+static struct task_struct * bdflush_task = NULL;
+static struct task_struct * bdflush_wait = NULL;
+
 /*
  * 等待bh解锁，可能发生进行切换
  */
@@ -159,14 +210,60 @@ void check_disk_change(int dev)
 	invalidate_buffers(dev);
 }
 
-#define _hashfn(dev,block) 	(((unsigned)(dev^block))%NR_HASH)
+/*
+ * 乘法哈希，取乘积的高位，相邻的块号分散到不同的桶中
+ */
+#define _hashfn(dev,block) 	((((unsigned)(dev)<<16 ^ (unsigned)(block)) * 0x9E3779B1U) >> (32 - hash_bits))
 #define hash(dev,block) 	hash_table[_hashfn(dev,block)]
 
+static inline void remove_from_list(struct buffer_head * bh)
+{
+	if (!(bh->b_prev_free) || !(bh->b_next_free))
+		panic("Free block list corrupted");
+	if (bh->b_next_free == bh)
+		lru_list[bh->b_list] = NULL;
+	else {
+		bh->b_prev_free->b_next_free = bh->b_next_free;
+		bh->b_next_free->b_prev_free = bh->b_prev_free;
+		if (lru_list[bh->b_list] == bh)
+			lru_list[bh->b_list] = bh->b_next_free;
+	}
+	bh->b_next_free = bh->b_prev_free = NULL;
+	nr_list[bh->b_list]--;
+}
+
+/*
+ * 放到链表list的尾部
+ */
+static inline void put_last_list(struct buffer_head * bh, int list)
+{
+	struct buffer_head * head = lru_list[list];
+
+	bh->b_list = list;
+	nr_list[list]++;
+	if (!head) {
+		lru_list[list] = bh->b_next_free = bh->b_prev_free = bh;
+		return;
+	}
+	bh->b_next_free = head;
+	bh->b_prev_free = head->b_prev_free;
+	head->b_prev_free->b_next_free = bh;
+	head->b_prev_free = bh;
+}
+
+/*
+ * 移到脏链表时记录写回的时间，脏链表按修改的先后排列
+ */
+static inline void refile_buffer(struct buffer_head * bh, int list)
+{
+	if (list == BUF_DIRTY && bh->b_list != BUF_DIRTY)
+		bh->b_flushtime = jiffies + bdf_prm[0];
+	remove_from_list(bh);
+	put_last_list(bh, list);
+}
+
 /*
- * 从hash表项中移除bh，在getblk中调用
- * 通过函数分析，可以分析发现bh移除后free_list会移动到下一个
- * 原因应该此bh可能被使用，当下一次调用getblk时可以直接获取一个没有用到的bh
- * 提高性能
+ * 从hash表项和链表中移除bh，在getblk中调用
  */
 static inline void remove_from_queues(struct buffer_head * bh)
 {
@@ -180,33 +277,16 @@ static inline void remove_from_queues(struct buffer_head * bh)
 	 */
 	if (hash(bh->b_dev,bh->b_blocknr) == bh)
 		hash(bh->b_dev,bh->b_blocknr) = bh->b_next;
-	/* remove from free list */
-	if (!(bh->b_prev_free) || !(bh->b_next_free))
-		panic("Free block list corrupted");
-	bh->b_prev_free->b_next_free = bh->b_next_free;
-	bh->b_next_free->b_prev_free = bh->b_prev_free;
-	/*
-	 * 如果是free_list的头部，则将头部设置为下一个
-	 */
-	if (free_list == bh)
-		free_list = bh->b_next_free;
+	remove_from_list(bh);
 }
 
 /*
- * 将bh加入buffer的空闲列表
+ * 将bh加入干净链表的尾部
  * 如果这个buffer和设备关联则将其根据设备号和block加入hash表中方便查找
- 
  */
 static inline void insert_into_queues(struct buffer_head * bh)
 {
-	/* put at end of free list */
-	/*
-	 * 将buffer加入free_list的最后面
-	 */
-	bh->b_next_free = free_list;
-	bh->b_prev_free = free_list->b_prev_free;
-	free_list->b_prev_free->b_next_free = bh;
-	free_list->b_prev_free = bh;
+	put_last_list(bh, BUF_CLEAN);
 	/* put the buffer in new hash-queue if it has a device */
 	bh->b_prev = NULL;
 	bh->b_next = NULL;
@@ -233,12 +313,40 @@ static struct buffer_head * find_buffer(int dev, int block)
 {		
 	struct buffer_head * tmp;
 
-	for (tmp = hash(dev, block); tmp != NULL; tmp = tmp->b_next)
+	hash_lookups++;
+	for (tmp = hash(dev, block); tmp != NULL; tmp = tmp->b_next) {
+		hash_probes++;
 		if (tmp->b_dev == dev && tmp->b_blocknr == block)
 			return tmp;
+	}
 	return NULL;
 }
 
+/*
+ * 打印哈希链的长度和平均每次查找比较的次数
+ */
+void buffer_hash_show(void)
+{
+	struct buffer_head * tmp;
+	int i, n, used = 0, max = 0, total = 0;
+
+	for (i = 0 ; i < (1 << hash_bits) ; i++) {
+		for (n = 0, tmp = hash_table[i] ; tmp ; tmp = tmp->b_next)
+			n++;
+		if (n)
+			used++;
+		if (n > max)
+			max = n;
+		total += n;
+	}
+	printk("buffer hash: %d buckets, %d used, %d hashed, max chain %d\n\r",
+		1 << hash_bits, used, total, max);
+	printk("buffer hash: %u lookups, %u.%02u probes per lookup\n\r",
+		hash_lookups, hash_lookups ? hash_probes / hash_lookups : 0,
+		hash_lookups ? hash_probes % hash_lookups * 100 / hash_lookups : 0);
+	printk("buffers: %d clean, %d dirty\n\r", nr_list[BUF_CLEAN], nr_list[BUF_DIRTY]);
+}
+
 /*
  * Why like this, I hear you say... The reason is race-conditions.
  * As we don't lock buffers (unless we are readint them, that is),
@@ -254,12 +362,16 @@ struct buffer_head * get_hash_table(int dev, int block)
 		/*
 		 * 在高速缓冲区中寻找dev和block对应的高速缓存
 		 */
-		if (!(bh=find_buffer(dev,block)))
+		spin_lock(&buffer_lock);
+		if (!(bh=find_buffer(dev,block))) {
+			spin_unlock(&buffer_lock);
 			return NULL;
+		}
 		/*
 		 * 增加引用计数
 		 */
 		bh->b_count++;
+		spin_unlock(&buffer_lock);
 		/*
 		 * 等待解锁
 		 */
@@ -284,113 +396,136 @@ struct buffer_head * get_hash_table(int dev, int block)
  * The algoritm is changed: hopefully better, and an elusive bug removed.
  */
 /*
- * 同时判断缓冲区的修改标志和锁定标志
+ * 在干净链表中从头部(最久没有使用)开始找一个可以替换的缓冲区，
+ * 遇到已经修改的缓冲区顺便移到脏链表，需要持有buffer_lock
  */
-#define BADNESS(bh) (((bh)->b_dirt<<1)+(bh)->b_lock)
+static struct buffer_head * get_clean_buffer(void)
+{
+	struct buffer_head * bh, * next;
+	int i;
+
+	bh = lru_list[BUF_CLEAN];
+	for (i = nr_list[BUF_CLEAN] ; i-- > 0 ; bh = next) {
+		next = bh->b_next_free;
+		if (bh->b_count || bh->b_lock)
+			continue;
+		if (bh->b_dirt) {
+			refile_buffer(bh, BUF_DIRTY);
+			continue;
+		}
+		return bh;
+	}
+	return NULL;
+}
+
+/*
+ * 没有干净的缓冲区时调用，从脏链表头部开始异步写回最多NR_WRITEBACK个，
+ * 已经写完的缓冲区移到干净链表头部，最先被替换
+ * 返回一个正在写的缓冲区，调用者等待它就可以，不需要像原来那样sync_dev整个设备
+ * 返回NULL表示脏缓冲区都在使用中
+ */
+#define NR_WRITEBACK	32
+
+static struct buffer_head * write_dirty_buffers(void)
+{
+	struct buffer_head * bh, * next, * list[NR_WRITEBACK];
+	int i, n = 0;
+
+	spin_lock(&buffer_lock);
+	bh = lru_list[BUF_DIRTY];
+	for (i = nr_list[BUF_DIRTY] ; i-- > 0 && n < NR_WRITEBACK ; bh = next) {
+		next = bh->b_next_free;
+		if (bh->b_count)
+			continue;
+		if (!bh->b_dirt && !bh->b_lock) {
+			refile_buffer(bh, BUF_CLEAN);
+			lru_list[BUF_CLEAN] = bh;	/* 循环链表，尾部变为头部 */
+			continue;
+		}
+		list[n++] = bh;
+	}
+	spin_unlock(&buffer_lock);
+	for (i = 0 ; i < n ; i++)
+		if (list[i]->b_dirt)
+			ll_rw_block(i ? WRITEA : WRITE, list[i]);
+	return n ? list[0] : NULL;
+}
+
 /*
  * 检查所指定的缓冲区是否已经在告诉缓冲中
  * 如果不在，需要建立
+ * 替换干净链表中最久没有使用的缓冲区，没有时写回一批脏缓冲区再重试
  */
 struct buffer_head * getblk(int dev, int block)
 {
-	struct buffer_head * tmp, * bh;
+	struct buffer_head * bh;
 
 repeat:
 	/*
 	 * 先根据dev和block在高速缓存hash表中获取，如果存在直接返回
 	 */
-	if ((bh = get_hash_table(dev, block)))
+	if ((bh = get_hash_table(dev, block))) {
+		cache_stats.getblk_hits++;
 		return bh;
-
-	/*
-	 * tmp指向缓冲区头部
-	 * 下面的代码意思是需要找到一个b_count为0的高速缓存
-	 * 一直对BANDNESS不理解，再次解释一下
-	 *
-	 * BANDNESS = bh->b_dirt*2 + bh->b_lock
-	 * 分析如下
-	 * 
-	 * 从free_list开始遍历
-	 * 第一次的时候bh为空因此可以进入if (!bh || BADNESS(tmp) < BADNESS(bh))
-	 * 将从free_list找到的可用tmp赋值为bh
-	 * 如果此bh的lock和dirt都为0，则直接可以用这个bh，否则继续进入循环
-	 * 此时又找到一个tmp，然后利用BADNESS宏进行对比
-	 * 可以发现系统倾向于选择一个lock和dirt都为0的缓冲区，如果实在找不到
-	 * 那就选择一个lock置位的，最后如果实在找不到那就找一个lock和dirt都为1的
-	 * 如果所有的b_count都在用，则睡眠一会在重新查找
-	 * BADNESS值越小表示使用该块的系统开销越小，优先选择该块。
-	 * 是否标记dirt对BADNES的计算结果有很大影响。
-	 * 如果块既“未锁定”又是“干净的”，则可以使用直接退出循环
-	 */	
-	tmp = free_list;
-	do {
-		if (tmp->b_count)
-			continue;
-		/*
-		 * 如果bh为空，第一次肯定为空
-		 */
-		if (!bh || BADNESS(tmp) < BADNESS(bh)) {
-			bh = tmp;
-			if (!BADNESS(tmp))
-				break;
-		}
-	/* and repeat until we find something good */
-	} while ((tmp = tmp->b_next_free) != free_list);
-	/*
-	 * 如果没有找到，则睡眠一会儿，然后继续找
-	 */
-	if (!bh) {
-		sleep_on(&buffer_wait);
-		goto repeat;
 	}
-	/*
-	 * 根据上面的BADNESS分析，获取的缓冲区如果上锁，需求等待解锁
-	 * wait_on_buffer会引起任务切换，因此需要再次检查该缓冲区的使用情况
-	 *
-	 */
-	wait_on_buffer(bh);
-	if (bh->b_count)
+	spin_lock(&buffer_lock);
+	if (!(bh = get_clean_buffer())) {
+		spin_unlock(&buffer_lock);
+		if ((bh = write_dirty_buffers()))
+			wait_on_buffer(bh);
+		else
+			sleep_on(&buffer_wait);
 		goto repeat;
-	/*
-	 * 如果该缓冲区已经被修改，则需要和磁盘进行同步并等待该缓冲区解锁
-	 *
-	 */
-	while (bh->b_dirt) {
-		sync_dev(bh->b_dev);
-		wait_on_buffer(bh);
-		if (bh->b_count)
-			goto repeat;
 	}
 	/* NOTE!! While we slept waiting for this block, somebody else might */
 	/* already have added "this" block to the cache. check it */
 	/*
-	 * 在上面的等待可能发生进程切换，也有可能导致指定的设备和块已经被加进入了
+	 * get_hash_table可能发生进程切换，也有可能导致指定的设备和块已经被加进入了
 	 */
-	if (find_buffer(dev, block))
+	if (find_buffer(dev, block)) {
+		spin_unlock(&buffer_lock);
 		goto repeat;
+	}
 	/* OK, FINALLY we know that this buffer is the only one of it's kind, */
 	/* and that it's unused (b_count=0), unlocked (b_lock=0), and clean */
 	bh->b_count = 1;
 	bh->b_dirt = 0;
 	bh->b_uptodate = 0;
 	/*
-	 * 将bh从free_list和hash表（如果存在）删除
+	 * 将bh从干净链表和hash表（如果存在）删除
 	 */
 	remove_from_queues(bh);
 	/*
-	 * 如果bh设置了b_dev则insert_int_queues会将bh加入hash表中
-	 * 也会将将bh加入free_list的尾部
-	 * 通过搜索remove_from_queues和insert_into_queues发现这两个函数只在本函数中调用
-	 * 因此一个bh无论如何都在free_list中存在
+	 * 重新加入hash表和干净链表的尾部
 	 */
 	bh->b_dev = dev;
 	bh->b_blocknr = block;
 	insert_into_queues(bh);
+	spin_unlock(&buffer_lock);
+	cache_stats.getblk_misses++;
 	return bh;
 }
+/*
+ * 脏缓冲区太多时唤醒回写进程，并让写的进程等待一个缓冲区写完，
+ * 写得越多等待得越多
+ */
+static void balance_dirty(void)
+{
+	struct buffer_head * bh;
+
+	if (nr_list[BUF_DIRTY] * 100 <= NR_BUFFERS * bdf_prm[2])
+		return;
+	wake_up(&bdflush_wait);
+	if (current == bdflush_task)
+		return;
+	if ((bh = write_dirty_buffers()))
+		wait_on_buffer(bh);
+}
+
 /*
  * 释放指定的缓冲区
  * 等待缓冲区解锁，引用计数递减1，唤醒等待空闲缓冲区的进程
+ * 不再使用的缓冲区按是否修改放到干净或者脏链表的尾部
  */
 void brelse(struct buffer_head * buf)
 {
@@ -399,7 +534,17 @@ void brelse(struct buffer_head * buf)
 	wait_on_buffer(buf);
 	if (!(buf->b_count--))
 		panic("Trying to free free buffer");
+	if (!buf->b_count) {
+		spin_lock(&buffer_lock);
+		if (!buf->b_dirt)
+			refile_buffer(buf, BUF_CLEAN);
+		else if (buf->b_list != BUF_DIRTY)
+			refile_buffer(buf, BUF_DIRTY);
+		spin_unlock(&buffer_lock);
+	}
 	wake_up(&buffer_wait);
+	if (buf->b_dirt)
+		balance_dirty();
 }
 
 /*
@@ -418,8 +563,11 @@ struct buffer_head * bread(int dev,int block)
 	/*
 	 * 如果该高速缓冲块是有效的，直接返回
 	 */
-	if (bh->b_uptodate)
+	if (bh->b_uptodate) {
+		cache_stats.bread_hits++;
 		return bh;
+	}
+	cache_stats.bread_misses++;
 	/*
 	 * 产生读设备请求
 	 */
@@ -541,6 +689,18 @@ void buffer_init(long buffer_end)
 	printk("BUFFER start_buffer is %x\n", start_buffer);
 	printk("BUFFER end_buffer is %x\n", buffer_end);
 
+	/*
+	 * 按照最多可能的缓冲区个数确定哈希表的大小，哈希表放在最前面
+	 */
+	i = ((long) b - (long) h) / (BLOCK_SIZE + sizeof(struct buffer_head));
+	for (hash_bits = 8 ; (1 << hash_bits) < i ; hash_bits++)
+		;
+	hash_table = (struct buffer_head **) h;
+	for (i = 0 ; i < (1 << hash_bits) ; i++)
+		hash_table[i] = NULL;
+	h = start_buffer = (struct buffer_head *)
+		ROUNDUP64((long) (hash_table + (1 << hash_bits)));
+
 	/*
 	 * h为start_buffer在实际跟踪过程中为end，end由链接程序生成，内核代码最末端
 	 * while里面保证h和b不重合
@@ -564,6 +724,8 @@ void buffer_init(long buffer_end)
 		h->b_data = (char *) b;
 		h->b_prev_free = h-1;
 		h->b_next_free = h+1;
+		h->b_list = BUF_CLEAN;
+		h->b_reqnext = NULL;
 		h++;
 		NR_BUFFERS++;
 		if (b == (void *) 0x100000)		//如果地址递减到1MB，则跳过显存和BIOS
@@ -573,16 +735,102 @@ void buffer_init(long buffer_end)
 	 * 此次需要减一
 	 *
 	 * 如下的语句就是将buffer_head组成一个双向循环链表
-	 * 头部为start_buffer，free_list指向start_buffer
+	 * 头部为start_buffer，开始时都在干净链表中
 	 */
 	h--;
-	free_list = start_buffer;
-	free_list->b_prev_free = h;
-	h->b_next_free = free_list;
-	/*
-	 * 初始化哈希表
-	 * 为了方便查找，内核使用hash表进行buffer的维护
-	 */
-	for (i=0; i < NR_HASH; i++)
-		hash_table[i]=NULL;
+	lru_list[BUF_CLEAN] = start_buffer;
+	start_buffer->b_prev_free = h;
+	h->b_next_free = start_buffer;
+	nr_list[BUF_CLEAN] = NR_BUFFERS;
+	printk("BUFFER %d buffers, %d hash buckets\n", NR_BUFFERS, 1 << hash_bits);
 }	
+
+/*
+ * 写回到期的脏缓冲区，超过ratio时不管是否到期都写回
+ * 脏链表按修改的先后排列，遇到没有到期的就可以停止
+ * 一次最多写NR_WRITEBACK个，返回写的个数
+ */
+static int flush_old_buffers(void)
+{
+	struct buffer_head * bh, * next, * list[NR_WRITEBACK];
+	int i, n = 0, over;
+
+	spin_lock(&buffer_lock);
+	over = nr_list[BUF_DIRTY] * 100 > NR_BUFFERS * bdf_prm[2];
+	bh = lru_list[BUF_DIRTY];
+	for (i = nr_list[BUF_DIRTY] ; i-- > 0 && n < NR_WRITEBACK ; bh = next) {
+		next = bh->b_next_free;
+		if (bh->b_count || bh->b_lock)
+			continue;
+		if (!bh->b_dirt) {
+			refile_buffer(bh, BUF_CLEAN);
+			continue;
+		}
+		if (!over && (long) (bh->b_flushtime - jiffies) > 0)
+			break;
+		list[n++] = bh;
+	}
+	spin_unlock(&buffer_lock);
+	for (i = 0 ; i < n ; i++)
+		ll_rw_block(WRITE, list[i]);
+	return n;
+}
+
+/*
+ * 回写进程，由init在启动时fork出来，调用bdflush(0)后一直在内核中运行
+ * 每隔interval个滴答，或者脏缓冲区太多时被唤醒，先把修改的i节点写到缓冲区，
+ * 再写回到期的脏缓冲区
+ * 除了SIGKILL屏蔽所有的信号，收到SIGKILL时返回
+ *
+ * func 1 	唤醒回写进程
+ * func 2n+2 	读取参数n到data指向的用户空间
+ * func 2n+3 	设置参数n为data
+ */
+int sys_bdflush(int func, long data)
+{
+	int i;
+
+	if (!suser())
+		return -EPERM;
+	if (func == 1) {
+		wake_up(&bdflush_wait);
+		return 0;
+	}
+	if (func >= 2) {
+		i = (func - 2) >> 1;
+		if (i >= NR_BDF_PARAM)
+			return -EINVAL;
+		if (func & 1) {
+			if (data < bdf_min[i] || data > bdf_max[i])
+				return -EINVAL;
+			bdf_prm[i] = data;
+			return 0;
+		}
+		verify_area((void *) data, sizeof(long));
+		put_fs_long(bdf_prm[i], (unsigned long *) data);
+		return 0;
+	}
+	if (func)
+		return -EINVAL;
+	if (bdflush_task)
+		return -EBUSY;
+	bdflush_task = current;
+	current->blocked = ~(1<<(SIGKILL-1));
+	for (;;) {
+		sync_inodes();
+		while (flush_old_buffers() == NR_WRITEBACK)
+			;
+		if (current->signal & (1<<(SIGKILL-1)))
+			break;
+		bdflush_wait = current;
+		current->timeout = jiffies + bdf_prm[1];
+		if (!next_timeout || current->timeout < next_timeout)
+			next_timeout = current->timeout;
+		current->state = TASK_INTERRUPTIBLE;
+		schedule();
+		current->timeout = 0;
+		bdflush_wait = NULL;
+	}
+	bdflush_task = NULL;
+	return 0;
+}
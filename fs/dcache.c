@@ -0,0 +1,176 @@
+/*
+ *  linux/fs/dcache.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 目录项缓存
+ *
+ * 路径解析的每一级都要在目录中线性查找，缓存(设备，目录i节点号，名字)到
+ * i节点号的对应关系，命中时不需要读目录块
+ * 找不到的名字也缓存(d_ino为0)，例如在PATH中逐个目录查找命令
+ *
+ * 按哈希表查找，LRU替换，和buffer.c一样使用双向循环链表
+ * 目录修改时由namei.c调用dcache_remove，删除目录和卸载时清除相关的项
+ * dcache_gen在每次删除项时加1，lookup在find_entry睡眠期间发现它变化时
+ * 不再把(可能已经过时的)结果加入缓存
+ */
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+
+#define NR_DENTRY	256
+#define NR_DHASH	64
+
+struct dentry {
+	unsigned short d_dev;
+	unsigned short d_dir;		/* 父目录的i节点号 */
+	unsigned short d_ino;		/* 0表示不存在 */
+	unsigned short d_len;		/* 0表示没有使用 */
+	char d_name[NAME_LEN];
+	struct dentry * d_hprev, * d_hnext;	/* 哈希链 */
+	struct dentry * d_prev, * d_next;	/* LRU链，表头是最久没有使用的 */
+};
+
+static struct dentry dentry_table[NR_DENTRY];
+static struct dentry * dhash_table[NR_DHASH];
+static struct dentry * lru_list = NULL;
+
+unsigned long dcache_hits = 0, dcache_misses = 0;
+unsigned long dcache_gen = 0;
+
+static int dhashfn(int dev, int dir, const char * name, int len)
+{
+	unsigned long h = dev ^ (dir << 4);
+
+	while (len--)
+		h = (h << 3) + (h >> 28) + *(name++);
+	return h % NR_DHASH;
+}
+
+void dcache_init(void)
+{
+	int i;
+
+	for (i = 0 ; i < NR_DENTRY ; i++) {
+		dentry_table[i].d_prev = dentry_table + (i + NR_DENTRY - 1) % NR_DENTRY;
+		dentry_table[i].d_next = dentry_table + (i + 1) % NR_DENTRY;
+	}
+	lru_list = dentry_table;
+}
+
+static void remove_from_hash(struct dentry * d)
+{
+	if (d->d_hnext)
+		d->d_hnext->d_hprev = d->d_hprev;
+	if (d->d_hprev)
+		d->d_hprev->d_hnext = d->d_hnext;
+	else if (dhash_table[dhashfn(d->d_dev, d->d_dir, d->d_name, d->d_len)] == d)
+		dhash_table[dhashfn(d->d_dev, d->d_dir, d->d_name, d->d_len)] = d->d_hnext;
+	d->d_hprev = d->d_hnext = NULL;
+	d->d_len = 0;
+}
+
+/*
+ * 移到LRU链的尾部，first为1时移到头部，下次最先被替换
+ */
+static void lru_move(struct dentry * d, int first)
+{
+	if (d == lru_list)
+		lru_list = d->d_next;
+	d->d_prev->d_next = d->d_next;
+	d->d_next->d_prev = d->d_prev;
+	d->d_next = lru_list;
+	d->d_prev = lru_list->d_prev;
+	lru_list->d_prev->d_next = d;
+	lru_list->d_prev = d;
+	if (first)
+		lru_list = d;
+}
+
+static struct dentry * find_dentry(int dev, int dir, const char * name, int len)
+{
+	struct dentry * d;
+
+	for (d = dhash_table[dhashfn(dev, dir, name, len)] ; d ; d = d->d_hnext)
+		if (d->d_dev == dev && d->d_dir == dir && d->d_len == len &&
+		    !strncmp(d->d_name, name, len))
+			return d;
+	return NULL;
+}
+
+/*
+ * name在内核空间，返回-1表示不在缓存中，0表示名字不存在，否则为i节点号
+ */
+int dcache_lookup(int dev, int dir, const char * name, int len)
+{
+	struct dentry * d;
+
+	if (!(d = find_dentry(dev, dir, name, len))) {
+		dcache_misses++;
+		return -1;
+	}
+	dcache_hits++;
+	lru_move(d, 0);
+	return d->d_ino;
+}
+
+void dcache_add(int dev, int dir, const char * name, int len, int ino)
+{
+	struct dentry * d;
+	int h;
+
+	if (!len || len > NAME_LEN)
+		return;
+	if (!(d = find_dentry(dev, dir, name, len))) {
+		d = lru_list;
+		if (d->d_len)
+			remove_from_hash(d);
+		d->d_dev = dev;
+		d->d_dir = dir;
+		d->d_len = len;
+		strncpy(d->d_name, name, len);
+		h = dhashfn(dev, dir, name, len);
+		d->d_hprev = NULL;
+		if ((d->d_hnext = dhash_table[h]))
+			d->d_hnext->d_hprev = d;
+		dhash_table[h] = d;
+	}
+	d->d_ino = ino;
+	lru_move(d, 0);
+}
+
+void dcache_remove(int dev, int dir, const char * name, int len)
+{
+	struct dentry * d;
+
+	dcache_gen++;
+	if ((d = find_dentry(dev, dir, name, len))) {
+		remove_from_hash(d);
+		lru_move(d, 1);
+	}
+}
+
+/*
+ * 删除目录时清除它下面的所有项，i节点号可能被新的目录使用
+ * dir为0时清除整个设备的项
+ */
+void dcache_purge(int dev, int dir)
+{
+	int i;
+
+	dcache_gen++;
+	for (i = 0 ; i < NR_DENTRY ; i++)
+		if (dentry_table[i].d_len && dentry_table[i].d_dev == dev &&
+		    (!dir || dentry_table[i].d_dir == dir)) {
+			remove_from_hash(dentry_table + i);
+			lru_move(dentry_table + i, 1);
+		}
+}
+
+void dcache_show(void)
+{
+	printk("dcache: %d hits, %d misses\n\r", dcache_hits, dcache_misses);
+}
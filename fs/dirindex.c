@@ -0,0 +1,383 @@
+/*
+ *  linux/fs/dirindex.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 大目录的哈希索引
+ *
+ * find_entry和add_entry逐项扫描整个目录，目录很大时每次创建文件都是O(n)
+ * 目录项不少于DI_MIN_ENTRIES的目录第一次查找时在内存中建立索引：
+ * 名字的哈希值到目录项所在位置(逻辑块号，块内序号)的哈希表，以及空闲目录项的链表
+ * 查找时只读哈希链上标记相同的目录项所在的块，创建时直接取空闲项或者追加
+ * 磁盘上的格式不变
+ *
+ * 目录只在namei.c中修改，add_entry取得空闲项(dindex_slot)，调用者写入i节点号后
+ * 调用dindex_insert，unlink和rmdir调用dindex_remove，删除目录和卸载时清除
+ *
+ * 建立索引和查找时bread会睡眠，期间目录可能被修改：
+ * 建立时被修改(di_changed)则放弃，查找时di_version变化则重新查找
+ */
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+
+#define NR_DINDEX	4		/* 同时有索引的目录数 */
+#define DI_MIN_ENTRIES	256		/* 目录项少于这个数时线性查找就够了 */
+#define DI_MAX_PAGES	128		/* 每个索引最多使用的节点页数 */
+#define DI_HASH		(PAGE_SIZE / sizeof (struct di_node *))
+#define DI_PER_PAGE	(PAGE_SIZE / sizeof (struct di_node))
+
+/*
+ * 节点的val: 低16位为逻辑块号，16-21位为块内序号，高8位为哈希值的另一部分，
+ * 比较名字之前先比较这8位，大部分名字不同的项不需要读块
+ */
+#define DI_BLOCK(v)	((v) & 0xffff)
+#define DI_SLOT(v)	(((v) >> 16) & 63)
+#define DI_TAG(v)	((v) >> 24)
+#define DI_VAL(block,slot,tag)	((block) | ((slot) << 16) | ((tag) << 24))
+
+struct di_node {
+	struct di_node * next;
+	unsigned long val;
+};
+
+struct dir_index {
+	unsigned short di_dev;		/* 0表示没有使用 */
+	unsigned short di_ino;
+	unsigned char di_busy;		/* 正在建立 */
+	unsigned char di_changed;	/* 建立期间目录被修改 */
+	unsigned long di_version;	/* 每次修改加1 */
+	unsigned long di_size;		/* 目录长度，包括已经分配给add_entry的追加项 */
+	unsigned long di_stamp;		/* 最近使用的时间，替换最久没有使用的 */
+	struct di_node ** di_hash;	/* 一页，DI_HASH个链表头 */
+	struct di_node * di_free;	/* 空闲目录项 */
+	struct di_node * di_unused;	/* 没有使用的节点 */
+	int di_pages;
+	unsigned long di_page[DI_MAX_PAGES];
+};
+
+static struct dir_index dindex_table[NR_DINDEX];
+static unsigned long dindex_clock = 0;
+
+unsigned long dindex_lookups = 0, dindex_builds = 0;
+
+/*
+ * 名字在磁盘上不足NAME_LEN时以0结尾
+ */
+static unsigned long dhashfn(const char * name, int len)
+{
+	unsigned long h = 0;
+
+	while (len-- && *name)
+		h = (h << 3) + (h >> 28) + *(name++);
+	return h;
+}
+
+#define DI_TAGFN(h)	(((h) / DI_HASH) & 0xff)
+
+static void free_index(struct dir_index * di)
+{
+	while (di->di_pages)
+		free_page(di->di_page[--di->di_pages]);
+	if (di->di_hash)
+		free_page((unsigned long) di->di_hash);
+	di->di_hash = NULL;
+	di->di_free = di->di_unused = NULL;
+	di->di_dev = di->di_ino = 0;
+	di->di_busy = 0;
+	di->di_version++;
+}
+
+static struct di_node * get_node(struct dir_index * di)
+{
+	struct di_node * n;
+	unsigned long page;
+	int i;
+
+	if (!di->di_unused) {
+		if (di->di_pages >= DI_MAX_PAGES || !(page = get_free_page()))
+			return NULL;
+		di->di_page[di->di_pages++] = page;
+		n = (struct di_node *) page;
+		for (i = 0 ; i < DI_PER_PAGE ; i++) {
+			n[i].next = di->di_unused;
+			di->di_unused = n + i;
+		}
+	}
+	n = di->di_unused;
+	di->di_unused = n->next;
+	return n;
+}
+
+/*
+ * 把目录项加入哈希表，或者空闲链表，节点用完时返回0
+ */
+static int index_entry(struct dir_index * di, struct buffer_head * bh,
+	struct dir_entry * de)
+{
+	struct di_node * n;
+	unsigned long h;
+	int slot = de - (struct dir_entry *) bh->b_data;
+
+	if (!(n = get_node(di)))
+		return 0;
+	if (!de->inode) {
+		n->val = DI_VAL(bh->b_blocknr, slot, 0);
+		n->next = di->di_free;
+		di->di_free = n;
+		return 1;
+	}
+	h = dhashfn(de->name, NAME_LEN);
+	n->val = DI_VAL(bh->b_blocknr, slot, DI_TAGFN(h));
+	n->next = di->di_hash[h % DI_HASH];
+	di->di_hash[h % DI_HASH] = n;
+	return 1;
+}
+
+static struct dir_index * find_index(struct m_inode * dir)
+{
+	int i;
+
+	for (i = 0 ; i < NR_DINDEX ; i++)
+		if (dindex_table[i].di_dev == dir->i_dev &&
+		    dindex_table[i].di_ino == dir->i_num)
+			return dindex_table + i;
+	return NULL;
+}
+
+/*
+ * 读整个目录建立索引，替换最久没有使用的索引，正在建立的不能替换
+ * 没有目录块的空洞不在索引中，add_entry不会再使用
+ */
+static struct dir_index * build_index(struct m_inode * dir)
+{
+	struct dir_index * di = NULL;
+	struct buffer_head * bh;
+	struct dir_entry * de;
+	int i, nr, block, entries;
+
+	entries = dir->i_size / sizeof (struct dir_entry);
+	if (entries < DI_MIN_ENTRIES || entries > DI_MAX_PAGES * DI_PER_PAGE)
+		return NULL;
+	for (i = 0 ; i < NR_DINDEX ; i++)
+		if (!dindex_table[i].di_busy &&
+		    (!di || dindex_table[i].di_stamp < di->di_stamp))
+			di = dindex_table + i;
+	if (!di)
+		return NULL;
+	free_index(di);
+	if (!(di->di_hash = (struct di_node **) get_free_page()))
+		return NULL;
+	di->di_dev = dir->i_dev;
+	di->di_ino = dir->i_num;
+	di->di_busy = 1;
+	di->di_changed = 0;
+	di->di_size = dir->i_size;
+	for (nr = 0 ; nr < entries ; nr += DIR_ENTRIES_PER_BLOCK) {
+		if (!(block = bmap(dir, nr / DIR_ENTRIES_PER_BLOCK)))
+			continue;
+		if (!(bh = bread(dir->i_dev, block)))
+			goto fail;
+		de = (struct dir_entry *) bh->b_data;
+		for (i = 0 ; i < DIR_ENTRIES_PER_BLOCK && nr + i < entries ; i++)
+			if (!index_entry(di, bh, de + i)) {
+				brelse(bh);
+				goto fail;
+			}
+		brelse(bh);
+		if (di->di_changed)
+			goto fail;
+	}
+	if (di->di_changed || dir->i_size != di->di_size)
+		goto fail;
+	di->di_busy = 0;
+	dindex_builds++;
+	return di;
+fail:
+	free_index(di);
+	return NULL;
+}
+
+/*
+ * 返回目录的索引，没有时建立，目录太小或者正在建立时返回NULL
+ */
+static struct dir_index * get_index(struct m_inode * dir)
+{
+	struct dir_index * di;
+
+	if ((di = find_index(dir))) {
+		if (di->di_busy)
+			return NULL;
+		if (dir->i_size > di->di_size)
+			free_index(di);
+		else {
+			di->di_stamp = ++dindex_clock;
+			return di;
+		}
+	}
+	if ((di = build_index(dir)))
+		di->di_stamp = ++dindex_clock;
+	return di;
+}
+
+/*
+ * name在用户空间，返回-1表示没有索引或者名字不能复制，需要线性查找，
+ * 0表示不存在，1表示找到，*res_bh和*res_dir为目录项
+ * bread和brelse都可能睡眠，之后di_version变化时n可能已经被释放或者
+ * 移到了空闲链表，重新查找
+ */
+int dindex_find(struct m_inode * dir, const char * name, int namelen,
+	struct buffer_head ** res_bh, struct dir_entry ** res_dir)
+{
+	char buf[NAME_LEN];
+	struct dir_index * di;
+	struct di_node * n;
+	struct buffer_head * bh;
+	struct dir_entry * de;
+	unsigned long h, val, version;
+
+	if (copy_from_user(buf, name, namelen))
+		return -1;
+	h = dhashfn(buf, namelen);
+repeat:
+	if (!(di = get_index(dir)))
+		return -1;
+	dindex_lookups++;
+	version = di->di_version;
+	for (n = di->di_hash[h % DI_HASH] ; n ; n = n->next) {
+		val = n->val;
+		if (DI_TAG(val) != DI_TAGFN(h))
+			continue;
+		bh = bread(dir->i_dev, DI_BLOCK(val));
+		if (di->di_version != version) {
+			brelse(bh);
+			goto repeat;
+		}
+		if (!bh)
+			continue;
+		de = (struct dir_entry *) bh->b_data + DI_SLOT(val);
+		if (de->inode && !strncmp(de->name, buf, namelen) &&
+		    (namelen == NAME_LEN || !de->name[namelen])) {
+			*res_bh = bh;
+			*res_dir = de;
+			return 1;
+		}
+		brelse(bh);
+		if (di->di_version != version)
+			goto repeat;
+	}
+	return 0;
+}
+
+/*
+ * 为add_entry取一个空闲目录项，返回-1表示没有索引
+ * *block不为0时返回值是逻辑块*block中的序号，
+ * 否则在目录末尾追加，返回值是目录项在目录中的序号
+ */
+int dindex_slot(struct m_inode * dir, int * block)
+{
+	struct dir_index * di;
+	struct di_node * n;
+	unsigned long val;
+
+	if (!(di = get_index(dir)))
+		return -1;
+	di->di_version++;
+	if ((n = di->di_free)) {
+		val = n->val;
+		di->di_free = n->next;
+		n->next = di->di_unused;
+		di->di_unused = n;
+		*block = DI_BLOCK(val);
+		return DI_SLOT(val);
+	}
+	*block = 0;
+	di->di_size += sizeof (struct dir_entry);
+	return di->di_size / sizeof (struct dir_entry) - 1;
+}
+
+/*
+ * add_entry的调用者写入de->inode之后调用，加入哈希表
+ */
+void dindex_insert(struct m_inode * dir, struct buffer_head * bh,
+	struct dir_entry * de)
+{
+	struct dir_index * di;
+
+	if (!(di = find_index(dir)))
+		return;
+	if (di->di_busy) {
+		di->di_changed = 1;
+		return;
+	}
+	di->di_version++;
+	if (!index_entry(di, bh, de))
+		free_index(di);
+}
+
+/*
+ * 目录项de已经清除(inode为0)，名字还在，从哈希表移到空闲链表
+ */
+void dindex_remove(struct m_inode * dir, struct buffer_head * bh,
+	struct dir_entry * de)
+{
+	struct dir_index * di;
+	struct di_node * n, ** p;
+	unsigned long h, val;
+
+	if (!(di = find_index(dir)))
+		return;
+	if (di->di_busy) {
+		di->di_changed = 1;
+		return;
+	}
+	di->di_version++;
+	h = dhashfn(de->name, NAME_LEN);
+	val = DI_VAL(bh->b_blocknr, de - (struct dir_entry *) bh->b_data, DI_TAGFN(h));
+	for (p = di->di_hash + h % DI_HASH ; (n = *p) ; p = &n->next)
+		if (n->val == val) {
+			*p = n->next;
+			n->val = DI_VAL(DI_BLOCK(val), DI_SLOT(val), 0);
+			n->next = di->di_free;
+			di->di_free = n;
+			return;
+		}
+	/*
+	 * 索引和目录不一致，下次重建
+	 */
+	free_index(di);
+}
+
+/*
+ * 删除目录和卸载时调用，ino为0时清除整个设备的索引
+ * 正在建立的索引由建立者放弃
+ */
+void dindex_purge(int dev, int ino)
+{
+	int i;
+
+	for (i = 0 ; i < NR_DINDEX ; i++)
+		if (dindex_table[i].di_dev == dev &&
+		    (!ino || dindex_table[i].di_ino == ino)) {
+			if (dindex_table[i].di_busy)
+				dindex_table[i].di_changed = 1;
+			else
+				free_index(dindex_table + i);
+		}
+}
+
+void dindex_show(void)
+{
+	int i, nr = 0;
+
+	for (i = 0 ; i < NR_DINDEX ; i++)
+		if (dindex_table[i].di_dev && !dindex_table[i].di_busy)
+			nr++;
+	printk("dindex: %d directories, %d lookups, %d builds\n\r",
+		nr, dindex_lookups, dindex_builds);
+}
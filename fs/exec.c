@@ -126,7 +126,7 @@ static unsigned long copy_strings(int argc,char ** argv,unsigned long *page,
 		unsigned long p, int from_kmem)
 {
 	char *tmp, *pag=NULL;
-	int len, offset = 0;
+	int len, chars;
 	unsigned long old_fs, new_fs;
 
 	if (!p) {
@@ -182,37 +182,40 @@ static unsigned long copy_strings(int argc,char ** argv,unsigned long *page,
 			return 0;
 		}
 		/* p的初始值为128KB的最后四个字节的地址
-		 * tmp为argv字符串的大小
-		 * len也是argv字符串的大小
+		 * tmp指向argv字符串的末尾
+		 * len是argv字符串的大小
 		 */
 		while (len) {
-			--p; --tmp; --len;
 			/*
-			 * --offset < 0 表示第一次， offset等于p这页面的偏移
+			 * 从字符串的末尾向前复制，每次最多复制到p-1所在页的开头
 			 */
-			if (--offset < 0) {
-				offset = p % PAGE_SIZE;
+			chars = (p - 1) % PAGE_SIZE + 1;
+			if (chars > len)
+				chars = len;
+			p -= chars; tmp -= chars; len -= chars;
+			if (from_kmem==2) {
+				set_fs(old_fs);
+			}
+			/*
+			 * page[p/PAGE_SIZE]表示p所在page的值如果为0，表示页不存在
+			 * 这个时候申请一个页作为pag和page[p/PAGE_SIZE]的值
+			 */
+			if (!(pag = (char *) page[p/PAGE_SIZE]) &&
+			    !(pag = (char *) (page[p/PAGE_SIZE] = get_free_page()))) { 
+				return 0;
+			}
+			if (from_kmem==2) {
+				set_fs(new_fs);
+			}
+			/*
+			 * 字符串地址出错时和空间不够一样返回0
+			 */
+			if (copy_from_user(pag + p % PAGE_SIZE, tmp, chars)) {
 				if (from_kmem==2) {
 					set_fs(old_fs);
 				}
-				/*
-				 * page[p/PAGE_SIZE]表示p所在page的值如果为0，表示页不存在
-				 * 这个时候申请一个页作为pag和page[p/PAGE_SIZE]的值
-				 */
-				if (!(pag = (char *) page[p/PAGE_SIZE]) &&
-				    !(pag = (char *) (page[p/PAGE_SIZE] = get_free_page()))) { 
-					return 0;
-				}
-				if (from_kmem==2) {
-					set_fs(new_fs);
-				}
+				return 0;
 			}
-			/*
-			 * 从这个页的开始存放tmp指向的字节，知道len为0，也就是复制整个字符串
-			 * 由于每复制一个字节，p和offset都会减一
-			 * 当offset为0时会p会减小到倒数第二个页，以此类推
-			 */
-			*(pag + offset) = get_fs_byte(tmp);
 		}
 	}
 	if (from_kmem == 2) {
@@ -477,6 +480,10 @@ restart_interp:
 	 * 此时p就是参数存放的虚拟地址
 	 */
 	p += change_ldt(ex.a_text, page) - MAX_ARG_PAGES*PAGE_SIZE;
+	/*
+	 * 映射共享时间页
+	 */
+	put_time_page();
 	/*
 	 * 处理环境变量和参数，返回新的参数存放地址的虚拟地址，
 	 * 也就是用户程序堆栈的虚拟地址
@@ -6,6 +6,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
@@ -14,44 +15,143 @@
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
-int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
+/*
+ * 在缓冲块p和用户的iov之间复制chars个字节，一块可以对应多个iov，
+ * 复制过的部分从iov中去掉，返回下一次开始的iov
+ * 读文件的空洞时p为NULL，填0
+ * 用户地址出错时返回NULL，调用者不计这一块，返回已经完成的字节数
+ */
+static struct iovec * iov_copy(int rw, char * p, struct iovec * iov, int chars)
+{
+	int n;
+
+	while (chars > 0) {
+		while (!iov->iov_len)
+			iov++;
+		n = MIN(chars, iov->iov_len);
+		if (rw == WRITE) {
+			if (copy_from_user(p, iov->iov_base, n))
+				return NULL;
+		} else if (p) {
+			if (copy_to_user(iov->iov_base, p, n))
+				return NULL;
+		} else {
+			char * buf = iov->iov_base;
+			int i;
+
+			for (i = 0 ; i < n ; i++)
+				put_fs_byte(0,buf++);
+		}
+		if (p)
+			p += n;
+		iov->iov_base = n + (char *) iov->iov_base;
+		iov->iov_len -= n;
+		chars -= n;
+	}
+	return iov;
+}
+
+/*
+ * 顺序读的预读
+ * 这次读的位置正好是上次读结束的位置时认为是顺序读，预读窗口从READA_MIN块开始
+ * 每次加倍，最大READA_MAX块，随机读时窗口变为0
+ * 预读这次读的范围后面窗口大小的块，已经预读过的块不再重复，
+ * 和breada一样只发出READA请求，不等待
+ * 不管是否顺序读，这次读的范围内的块也先一起发出请求，
+ * 复制循环中的bread只等待，不用一块一块地读
+ */
+#define READA_MIN	4
+#define READA_MAX	32
+
+static void reada_blocks(struct m_inode * inode, unsigned long block,
+	unsigned long end)
 {
-	int left,chars,nr;
+	struct buffer_head * bh;
+	int nr;
+
+	for ( ; block < end ; block++) {
+		if (!(nr = bmap(inode, block)))
+			continue;
+		if (!(bh = getblk(inode->i_dev, nr)))
+			continue;
+		if (!bh->b_uptodate)
+			ll_rw_block(READA, bh);
+		bh->b_count--;
+	}
+}
+
+static void file_readahead(struct m_inode * inode, struct file * filp,
+	off_t pos, int count)
+{
+	unsigned long block, end;
+
+	block = (pos + count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	if (block > pos / BLOCK_SIZE + 1)
+		reada_blocks(inode, pos / BLOCK_SIZE, block);
+	if (pos != filp->f_ra_next) {
+		filp->f_ra_size = filp->f_ra_end = 0;
+		return;
+	}
+	filp->f_ra_size = filp->f_ra_size ?
+		MIN(filp->f_ra_size * 2, READA_MAX) : READA_MIN;
+	end = MIN(block + filp->f_ra_size,
+		(inode->i_size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	if (block < filp->f_ra_end)
+		block = filp->f_ra_end;
+	reada_blocks(inode, block, end);
+	if (end > filp->f_ra_end)
+		filp->f_ra_end = end;
+}
+
+/*
+ * iov已经复制到内核中，count为iov的总长度，调用者已经按文件大小截断
+ * pos为读写的位置，read/write时是&filp->f_pos，pread/pwrite时是局部变量
+ */
+int file_read(struct m_inode * inode, struct file * filp, off_t * pos,
+	struct iovec * iov, int count)
+{
+	int left,chars,nr,err = ERROR;
 	struct buffer_head * bh;
 
 	if ((left=count)<=0)
 		return 0;
+	file_readahead(inode, filp, *pos, count);
 	while (left) {
-		if ((nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE))) {
+		if ((nr = bmap(inode,(*pos)/BLOCK_SIZE))) {
 			if (!(bh=bread(inode->i_dev,nr)))
 				break;
 		} else
 			bh = NULL;
-		nr = filp->f_pos % BLOCK_SIZE;
+		nr = *pos % BLOCK_SIZE;
 		chars = MIN( BLOCK_SIZE-nr , left );
-		filp->f_pos += chars;
-		left -= chars;
 		if (bh) {
-			char * p = nr + bh->b_data;
-			while (chars-->0)
-				put_fs_byte(*(p++),buf++);
+			iov = iov_copy(READ, nr + bh->b_data, iov, chars);
 			brelse(bh);
-		} else {
-			while (chars-->0)
-				put_fs_byte(0,buf++);
+		} else
+			iov = iov_copy(READ, NULL, iov, chars);
+		if (!iov) {
+			err = EFAULT;
+			break;
 		}
+		*pos += chars;
+		left -= chars;
 	}
+	filp->f_ra_next = *pos;
 	inode->i_atime = CURRENT_TIME;
-	return (count-left)?(count-left):-ERROR;
+	return (count-left)?(count-left):-err;
 }
 
-int file_write(struct m_inode * inode, struct file * filp, char * buf, int count)
+/*
+ * 聚集写时一个缓冲块只读一次，从多个iov中填满
+ */
+int file_write(struct m_inode * inode, struct file * filp, off_t * fpos,
+	struct iovec * iov, int count)
 {
 	off_t pos;
 	int block,c;
 	struct buffer_head * bh;
 	char * p;
-	int i=0;
+	int i=0, err=1;
 
 /*
  * ok, append may not work when many processes are writing at the same time
@@ -60,7 +160,7 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 	if (filp->f_flags & O_APPEND)
 		pos = inode->i_size;
 	else
-		pos = filp->f_pos;
+		pos = *fpos;
 	while (i<count) {
 		if (!(block = create_block(inode,pos/BLOCK_SIZE)))
 			break;
@@ -71,20 +171,23 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 		bh->b_dirt = 1;
 		c = BLOCK_SIZE-c;
 		if (c > count-i) c = count-i;
+		iov = iov_copy(WRITE, p, iov, c);
+		brelse(bh);
+		if (!iov) {
+			err = EFAULT;
+			break;
+		}
 		pos += c;
 		if (pos > inode->i_size) {
 			inode->i_size = pos;
 			inode->i_dirt = 1;
 		}
 		i += c;
-		while (c-->0)
-			*(p++) = get_fs_byte(buf++);
-		brelse(bh);
 	}
 	inode->i_mtime = CURRENT_TIME;
 	if (!(filp->f_flags & O_APPEND)) {
-		filp->f_pos = pos;
+		*fpos = pos;
 		inode->i_ctime = CURRENT_TIME;
 	}
-	return (i?i:-1);
+	return (i?i:-err);
 }
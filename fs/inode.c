@@ -5,17 +5,38 @@
  */
 
 #include <string.h> 
+#include <stddef.h>
 #include <sys/stat.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <asm/system.h>
+#include <asm/spinlock.h>
 
 /*
- * 内存中的i节点指针，一共32个
+ * 内存中的i节点按页分配，需要时增加，最多NR_INODE个
+ * inode_list 	所有的i节点，sync和卸载时扫描
+ * inode_hash 	有设备号的i节点，按(dev, nr)查找
+ * unused_list 	引用计数为0的i节点，双向循环链表，表头是最久没有使用的
  */
-struct m_inode inode_table[NR_INODE]={{0,},};
+#define NR_IHASH	131
+#define _ihashfn(dev,nr)	(((unsigned)(dev^nr))%NR_IHASH)
+
+static struct m_inode * inode_list = NULL;
+static struct m_inode * inode_hash[NR_IHASH];
+static struct m_inode * unused_list = NULL;
+int nr_inodes = 0, nr_free_inodes = 0;
+
+/*
+ * get_empty_inode时清零的部分，链表指针在最后不清除
+ */
+#define INODE_CLEAR_SIZE	offsetof(struct m_inode, i_next)
+
+/*
+ * 保护i节点的查找和分配，单处理器时为空
+ */
+static spinlock_t inode_lock = SPIN_LOCK_UNLOCKED;
 
 static void read_inode(struct m_inode * inode);
 static void write_inode(struct m_inode * inode);
@@ -52,41 +73,168 @@ static inline void unlock_inode(struct m_inode * inode)
 	wake_up(&inode->i_wait);
 }
 
+/*
+ * 以下链表操作需要持有inode_lock
+ */
+static struct m_inode * find_inode(int dev, int nr)
+{
+	struct m_inode * inode;
+
+	for (inode = inode_hash[_ihashfn(dev,nr)] ; inode ; inode = inode->i_hash_next)
+		if (inode->i_dev == dev && inode->i_num == nr)
+			return inode;
+	return NULL;
+}
+
+static void insert_inode_hash(struct m_inode * inode)
+{
+	struct m_inode ** h = inode_hash + _ihashfn(inode->i_dev,inode->i_num);
+
+	inode->i_hash_prev = NULL;
+	if ((inode->i_hash_next = *h))
+		(*h)->i_hash_prev = inode;
+	*h = inode;
+}
+
+static void remove_inode_hash(struct m_inode * inode)
+{
+	if (inode->i_hash_next)
+		inode->i_hash_next->i_hash_prev = inode->i_hash_prev;
+	if (inode->i_hash_prev)
+		inode->i_hash_prev->i_hash_next = inode->i_hash_next;
+	else if (inode_hash[_ihashfn(inode->i_dev,inode->i_num)] == inode)
+		inode_hash[_ihashfn(inode->i_dev,inode->i_num)] = inode->i_hash_next;
+	inode->i_hash_next = inode->i_hash_prev = NULL;
+}
+
+static void remove_unused_inode(struct m_inode * inode)
+{
+	if (!inode->i_lru_next)
+		return;
+	if (inode->i_lru_next == inode)
+		unused_list = NULL;
+	else {
+		if (unused_list == inode)
+			unused_list = inode->i_lru_next;
+		inode->i_lru_prev->i_lru_next = inode->i_lru_next;
+		inode->i_lru_next->i_lru_prev = inode->i_lru_prev;
+	}
+	inode->i_lru_next = inode->i_lru_prev = NULL;
+	nr_free_inodes--;
+}
+
+/*
+ * 放到LRU链表的尾部，first为1时放到头部，最先被重新使用
+ */
+static void add_unused_inode(struct m_inode * inode, int first)
+{
+	if (inode->i_lru_next)
+		return;
+	if (!unused_list) {
+		unused_list = inode->i_lru_next = inode->i_lru_prev = inode;
+	} else {
+		inode->i_lru_next = unused_list;
+		inode->i_lru_prev = unused_list->i_lru_prev;
+		unused_list->i_lru_prev->i_lru_next = inode;
+		unused_list->i_lru_prev = inode;
+		if (first)
+			unused_list = inode;
+	}
+	nr_free_inodes++;
+}
+
+static void put_unused_inode(struct m_inode * inode, int first)
+{
+	spin_lock(&inode_lock);
+	add_unused_inode(inode, first);
+	spin_unlock(&inode_lock);
+}
+
+/*
+ * 分配一页新的i节点，不会睡眠
+ */
+static void grow_inodes(void)
+{
+	struct m_inode * inode;
+	int i;
+
+	if (!(inode = (struct m_inode *) get_free_page()))
+		return;
+	for (i = PAGE_SIZE / sizeof(struct m_inode) ; i && nr_inodes < NR_INODE ; i--, inode++) {
+		inode->i_next = inode_list;
+		inode_list = inode;
+		nr_inodes++;
+		add_unused_inode(inode, 1);
+	}
+}
+
 /*
  * 释放内存中设备dev的i节点
  */
 void invalidate_inodes(int dev)
 {
-	int i;
 	struct m_inode * inode;
 
-	inode = 0 + inode_table;
-	/*
-	 * 扫描inode_table
-	 */
-	for(i = 0; i < NR_INODE; i++, inode++) {
+	for (inode = inode_list ; inode ; inode = inode->i_next) {
 		wait_on_inode(inode);
 		if (inode->i_dev == dev) {
 			if (inode->i_count)
 				printk("inode in use on removed disk\n\r");
+			spin_lock(&inode_lock);
+			remove_inode_hash(inode);
 			inode->i_dev = inode->i_dirt = 0;
+			spin_unlock(&inode_lock);
 		}
 	}
 }
 
 void sync_inodes(void)
 {
-	int i;
 	struct m_inode * inode;
 
-	inode = 0 + inode_table;
-	for(i=0; i < NR_INODE; i++, inode++) {
+	for (inode = inode_list ; inode ; inode = inode->i_next) {
 		wait_on_inode(inode);
 		if (inode->i_dirt && !inode->i_pipe)
 			write_inode(inode);
 	}
 }
 
+/*
+ * 设备dev上还有i节点在使用时不能卸载
+ */
+int fs_may_umount(int dev)
+{
+	struct m_inode * inode;
+
+	for (inode = inode_list ; inode ; inode = inode->i_next)
+		if (inode->i_dev == dev && inode->i_count)
+			return 0;
+	return 1;
+}
+
+/*
+ * new_inode设置了设备和i节点号后加入哈希表
+ */
+void hash_new_inode(struct m_inode * inode)
+{
+	spin_lock(&inode_lock);
+	insert_inode_hash(inode);
+	spin_unlock(&inode_lock);
+}
+
+/*
+ * 由free_inode调用，i节点不再对应磁盘上的任何i节点，
+ * 清除数据后放到LRU链表头部
+ */
+void clear_inode(struct m_inode * inode)
+{
+	spin_lock(&inode_lock);
+	remove_inode_hash(inode);
+	memset(inode, 0, INODE_CLEAR_SIZE);
+	add_unused_inode(inode, 1);
+	spin_unlock(&inode_lock);
+}
+
 /*
  * 文件数据映射到盘块的处理操作
  * 如果create为置位，则对应逻辑快不存在应该申请新的逻辑快
@@ -95,11 +243,15 @@ void sync_inodes(void)
  * block 文件的block数据块号
  * create 是否进行创建
  * 
+ * 新的块从文件前一块的下一块开始分配(GOAL)，间接块中的第一项从间接块的下一块开始，
+ * 使文件的块尽量连续
  */
+#define GOAL(prev)	((prev) ? (prev) + 1 : 0)
+
 static int _bmap(struct m_inode * inode, int block, int create)
 {
 	struct buffer_head * bh;
-	int i;
+	int i, ind;
 
 	/*
 	 * 判断块大小的有效性
@@ -118,7 +270,8 @@ static int _bmap(struct m_inode * inode, int block, int create)
 		 * 最后返回逻辑块号
 		 */
 		if (create && !inode->i_zone[block])
-			if ((inode->i_zone[block] = new_block(inode->i_dev))) {
+			if ((inode->i_zone[block] = new_file_block(inode,
+			    block ? GOAL(inode->i_zone[block-1]) : 0))) {
 				inode->i_ctime = CURRENT_TIME;
 				inode->i_dirt = 1;
 			}
@@ -134,7 +287,8 @@ static int _bmap(struct m_inode * inode, int block, int create)
 		 * 则需申请一个块存放间接块信息
 		 */
 		if (create && !inode->i_zone[7])
-			if ((inode->i_zone[7] = new_block(inode->i_dev))) {
+			if ((inode->i_zone[7] = new_file_block(inode,
+			    GOAL(inode->i_zone[6])))) {
 				inode->i_dirt = 1;
 				inode->i_ctime = CURRENT_TIME;
 			}
@@ -157,7 +311,9 @@ static int _bmap(struct m_inode * inode, int block, int create)
 		 * 并设置已修改标记，释放缓冲区
 		 */
 		if (create && !i)
-			if ((i = new_block(inode->i_dev))) {
+			if ((i = new_file_block(inode, block ?
+			    GOAL(((unsigned short *) (bh->b_data))[block-1]) :
+			    inode->i_zone[7] + 1))) {
 				((unsigned short *) (bh->b_data))[block] = i;
 				bh->b_dirt = 1;
 			}
@@ -169,7 +325,8 @@ static int _bmap(struct m_inode * inode, int block, int create)
 	 */
 	block -= 512;
 	if (create && !inode->i_zone[8])
-		if ((inode->i_zone[8] = new_block(inode->i_dev))) {
+		if ((inode->i_zone[8] = new_file_block(inode,
+		    GOAL(inode->i_zone[7])))) {
 			inode->i_dirt = 1;
 			inode->i_ctime = CURRENT_TIME;
 		}
@@ -179,7 +336,9 @@ static int _bmap(struct m_inode * inode, int block, int create)
 		return 0;
 	i = ((unsigned short *)bh->b_data)[block>>9];
 	if (create && !i)
-		if ((i = new_block(inode->i_dev))) {
+		if ((i = new_file_block(inode, (block>>9) ?
+		    GOAL(((unsigned short *) (bh->b_data))[(block>>9)-1]) :
+		    inode->i_zone[8] + 1))) {
 			((unsigned short *) (bh->b_data))[block>>9]=i;
 			bh->b_dirt=1;
 		}
@@ -188,12 +347,15 @@ static int _bmap(struct m_inode * inode, int block, int create)
 		return 0;
 	if (!(bh = bread(inode->i_dev,i)))
 		return 0;
+	ind = i;
 	/*
 	 * block&511为为了限制其大小最大为511
 	 */
 	i = ((unsigned short *)bh->b_data)[block&511];
 	if (create && !i)
-		if ((i = new_block(inode->i_dev))) {
+		if ((i = new_file_block(inode, (block&511) ?
+		    GOAL(((unsigned short *) (bh->b_data))[(block&511)-1]) :
+		    ind + 1))) {
 			((unsigned short *) (bh->b_data))[block&511]=i;
 			bh->b_dirt = 1;
 		}
@@ -223,6 +385,7 @@ int create_block(struct m_inode * inode, int block)
 		
 /*
  * 释放一个i节点，回写入设备
+ * 引用计数减为0的i节点放到LRU链表中，仍然在哈希表里，iget时可以直接使用
  */		
 void iput(struct m_inode * inode)
 {
@@ -236,13 +399,14 @@ void iput(struct m_inode * inode)
 		if (--inode->i_count)
 			return;
 		free_page(inode->i_size);
-		inode->i_count=0;
 		inode->i_dirt=0;
 		inode->i_pipe=0;
+		put_unused_inode(inode, 1);
 		return;
 	}
 	if (!inode->i_dev) {
-		inode->i_count--;
+		if (!--inode->i_count)
+			put_unused_inode(inode, 1);
 		return;
 	}
 	if (S_ISBLK(inode->i_mode)) {
@@ -259,60 +423,59 @@ repeat:
 		free_inode(inode);
 		return;
 	}
+	/*
+	 * 最后一次关闭，释放预分配的块，可能睡眠
+	 */
+	if (inode->i_prealloc_count) {
+		discard_prealloc(inode);
+		goto repeat;
+	}
 	if (inode->i_dirt) {
 		write_inode(inode);	/* we can sleep - so do again */
 		wait_on_inode(inode);
 		goto repeat;
 	}
 	inode->i_count--;
+	put_unused_inode(inode, 0);
 	return;
 }
 
 /*
  * 从i节点列表中获取一个空闲i节点
+ * 空闲的i节点少于四分之一时先分配新的一页，否则从LRU链表头部开始，
+ * 优先使用没有修改也没有上锁的i节点
  */
 struct m_inode * get_empty_inode(void)
 {
-	struct m_inode * inode;
-	static struct m_inode * last_inode = inode_table;
+	struct m_inode * inode, * tmp;
 	int i;
 
-	do {
+	for (;;) {
 		inode = NULL;
-		/*
-		 * NR_INODE是系统定义的inode的最大数
-		 * 也是寻找inode的循环计数
-		 *
-		 */
-		for (i = NR_INODE; i; i--) {
-			/*
-			 * 如果last_inode已经指向i节点表的最后一项
-			 * 则让其重新指向i节点的开始处
-			 * 也就是inode_table
-			 *
-			 */
-			if (++last_inode >= inode_table + NR_INODE)
-				last_inode = inode_table;
+		spin_lock(&inode_lock);
+		if (nr_free_inodes < nr_inodes / 4 + 1 && nr_inodes < NR_INODE)
+			grow_inodes();
+		for (tmp = unused_list, i = nr_free_inodes; i; i--, tmp = tmp->i_lru_next) {
 			/*
 			 * i_count为0表示可能是空闲项
 			 * 如果i节点的已修改和锁定标志均为0，则退出
 			 *
 			 */
-			if (!last_inode->i_count) {
-				inode = last_inode;
-				if (!inode->i_dirt && !inode->i_lock)
+			if (!tmp->i_count) {
+				if (!inode)
+					inode = tmp;
+				if (!tmp->i_dirt && !tmp->i_lock) {
+					inode = tmp;
 					break;
+				}
 			}
 		}
+		spin_unlock(&inode_lock);
 		/*
 		 * 如果没有找到i节点，打印调试信息，然后系统panic
-		 *  
-		 *
 		 */
 		if (!inode) {
-			for (i=0 ; i<NR_INODE ; i++)
-				printk("%04x: %6d\t",inode_table[i].i_dev,
-					inode_table[i].i_num);
+			printk("%d inodes, %d free\n\r", nr_inodes, nr_free_inodes);
 			panic("No free inodes in mem");
 		}
 		/*
@@ -325,14 +488,19 @@ struct m_inode * get_empty_inode(void)
 			write_inode(inode);
 			wait_on_inode(inode);
 		}
-	} while (inode->i_count);
+		spin_lock(&inode_lock);
+		if (!inode->i_count)
+			break;
+		spin_unlock(&inode_lock);
+	}
 	/*
-	 * 将i节点的数据清零，并设置计数
-	 *
-	 *
+	 * 从LRU和哈希表中取下，将i节点的数据清零，并设置计数
 	 */
-	memset(inode, 0, sizeof(*inode));
+	remove_unused_inode(inode);
+	remove_inode_hash(inode);
+	memset(inode, 0, INODE_CLEAR_SIZE);
 	inode->i_count = 1;
+	spin_unlock(&inode_lock);
 	return inode;
 }
 
@@ -343,7 +511,7 @@ struct m_inode * get_pipe_inode(void)
 	if (!(inode = get_empty_inode()))
 		return NULL;
 	if (!(inode->i_size = get_free_page())) {
-		inode->i_count = 0;
+		iput(inode);
 		return NULL;
 	}
 	inode->i_count = 2;	/* sum of readers/writers */
@@ -355,91 +523,79 @@ struct m_inode * get_pipe_inode(void)
 /*
  * dev表示设备，nr表示i节点号
  * ROOT_INO定义为1
+ * 先在哈希表中查找，找不到时才分配空闲i节点，分配时可能睡眠，所以要重新查找
  */
 struct m_inode * iget(int dev, int nr)
 {
-	struct m_inode * inode, * empty;
+	struct m_inode * inode, * empty = NULL;
 
 	if (!dev)
 		panic("iget with dev==0");
+repeat:
+	spin_lock(&inode_lock);
+	if (!(inode = find_inode(dev, nr))) {
+		if (!empty) {
+			spin_unlock(&inode_lock);
+			if (!(empty = get_empty_inode()))
+				return NULL;
+			goto repeat;
+		}
+		inode = empty;
+		inode->i_dev = dev;
+		inode->i_num = nr;
+		insert_inode_hash(inode);
+		spin_unlock(&inode_lock);
+		read_inode(inode);
+		return inode;
+	}
+	spin_unlock(&inode_lock);
 	/*
-	 * 从inode_tabale中获取一个空的inode
-	 *
+	 * 在这里说明已经找到了指定的i节点
+	 * 等待inode解锁，这里可能发生睡眠
+	 * 确保在等待期间i节点信息没有发生变化，如果发生变化重新查找
 	 */
-	empty = get_empty_inode();
-	inode = inode_table;
+	wait_on_inode(inode);
+	if (inode->i_dev != dev || inode->i_num != nr)
+		goto repeat;
 	/*
-	 * 扫描inode_table找到i节点的dev和nr为特定值的i节点
-	 *
-	 *
+	 * 增加引用计数，没有使用的i节点从LRU链表中取下
 	 */
-	while (inode < NR_INODE + inode_table) {
-		/*
-		 * 判断设备号和i节点编号是否为指定的值
-		 * 如果不是，继续尝试下一个inode
-		 */
-		if (inode->i_dev != dev || inode->i_num != nr) {
-			inode++;
-			continue;
-		}
-		/*
-		 * 在这里说明已经找到了指定的i节点
-		 * 等待inode解锁，这里可能发生睡眠
-		 */
-		wait_on_inode(inode);
-		/*
-		 * 确保在等待期间i节点信息没有发生变化
-		 * 如果发生变化，将inode_table赋值给inode并继续寻找
-		 */
-		if (inode->i_dev != dev || inode->i_num != nr) {
-			inode = inode_table;
-			continue;
-		}
-		/*
-		 * 增加引用计数
-		 */
-		inode->i_count++;
+	spin_lock(&inode_lock);
+	if (!inode->i_count++)
+		remove_unused_inode(inode);
+	spin_unlock(&inode_lock);
+	/*
+	 * 如果inode的i_mount有值说明这个i节点挂载了其他分区
+	 */
+	if (inode->i_mount) {
+		int i;
 		/*
-		 * 如果inode的i_mount有值说明这个i节点挂载了其他分区
+		 * 扫描超级块并找到inode挂载的超级块
 		 */
-		if (inode->i_mount) {
-			int i;
-			/*
-			 * 扫描超级块并找到inode挂载的超级块
-			 */
-			for (i = 0; i < NR_SUPER; i++)
-				if (super_block[i].s_imount == inode)
-					break;
-			if (i >= NR_SUPER) {
-				printk("Mounted inode hasn't got sb\n");
-				if (empty)
-					iput(empty);
-				return inode;
-			}
-			/*
-			 * 将该i节点写盘
-			 * 从安装在此i节点的超级块中获取设备号
-			 * 从新使用新的设备从开始进行扫描
-			 */
-			iput(inode);
-			dev = super_block[i].s_dev;
-			nr = ROOT_INO;
-			inode = inode_table;
-			continue;
+		for (i = 0; i < NR_SUPER; i++)
+			if (super_block[i].s_imount == inode)
+				break;
+		if (i >= NR_SUPER) {
+			printk("Mounted inode hasn't got sb\n");
+			if (empty)
+				iput(empty);
+			return inode;
 		}
 		/*
-		 * 放弃临时i节点
+		 * 将该i节点写盘
+		 * 从安装在此i节点的超级块中获取设备号
+		 * 从新使用新的设备从开始进行扫描
 		 */
-		if (empty)
-			iput(empty);
-		return inode;
+		iput(inode);
+		dev = super_block[i].s_dev;
+		nr = ROOT_INO;
+		goto repeat;
 	}
-	if (!empty)
-		return (NULL);
-	inode = empty;
-	inode->i_dev = dev;
-	inode->i_num = nr;
-	read_inode(inode);
+	/*
+	 * 放弃临时i节点
+	 */
+	if (empty)
+		iput(empty);
 	return inode;
 }
 
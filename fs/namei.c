@@ -169,6 +169,11 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 	if (!(block = (*dir)->i_zone[0])) {
 		return NULL;
 	}
+	/*
+	 * 大目录使用哈希索引
+	 */
+	if ((i = dindex_find(*dir, name, namelen, &bh, res_dir)) >= 0)
+		return i ? bh : NULL;
 	/*
 	 * 读取该block的数据
 	 */
@@ -213,6 +218,72 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 	return NULL;
 }
 
+/*
+ * 先查目录项缓存，不在缓存中再调用find_entry，结果(包括不存在)加入缓存
+ * 返回i节点号，0表示不存在
+ * '.'和'..'不缓存，'..'在find_entry中可能会越过挂载点改变*dir
+ * find_entry中可能睡眠，期间有项被删除(dcache_gen变化)时结果不加入缓存
+ */
+static int lookup(struct m_inode ** dir, const char * name, int namelen)
+{
+	char buf[NAME_LEN];
+	struct buffer_head * bh;
+	struct dir_entry * de;
+	unsigned long gen;
+	int inr;
+
+#ifdef NO_TRUNCATE
+	if (namelen > NAME_LEN)
+		return 0;
+#else
+	if (namelen > NAME_LEN)
+		namelen = NAME_LEN;
+#endif
+	if (!namelen || copy_from_user(buf, name, namelen))
+		goto nocache;
+	if (buf[0] == '.' && (namelen == 1 || (namelen == 2 && buf[1] == '.')))
+		goto nocache;
+	if ((inr = dcache_lookup((*dir)->i_dev, (*dir)->i_num, buf, namelen)) >= 0)
+		return inr;
+	gen = dcache_gen;
+	bh = find_entry(dir, name, namelen, &de);
+	inr = bh ? de->inode : 0;
+	brelse(bh);
+	if (gen == dcache_gen)
+		dcache_add((*dir)->i_dev, (*dir)->i_num, buf, namelen, inr);
+	return inr;
+nocache:
+	if (!(bh = find_entry(dir, name, namelen, &de)))
+		return 0;
+	inr = de->inode;
+	brelse(bh);
+	return inr;
+}
+
+/*
+ * 目录中的name改变了，从目录项缓存中去掉
+ * 名字不能复制时清除整个目录的项
+ */
+static void forget_entry(struct m_inode * dir, const char * name, int namelen)
+{
+	char buf[NAME_LEN];
+
+#ifdef NO_TRUNCATE
+	if (namelen > NAME_LEN)
+		return;
+#else
+	if (namelen > NAME_LEN)
+		namelen = NAME_LEN;
+#endif
+	if (!namelen)
+		return;
+	if (copy_from_user(buf, name, namelen)) {
+		dcache_purge(dir->i_dev, dir->i_num);
+		return;
+	}
+	dcache_remove(dir->i_dev, dir->i_num, buf, namelen);
+}
+
 /*
  * add_entry()
  *
@@ -222,11 +293,14 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
  * NOTE!! The inode part of 'de' is left at 0 - which means you
  * may not sleep between calling this and putting something into
  * the entry, as someone else might have used it while you slept.
+ *
+ * add_entry中可能睡眠，期间的lookup会把名字作为不存在的项缓存，
+ * 所以调用者写入de->inode之后才调用dindex_insert和forget_entry
  */
 static struct buffer_head * add_entry(struct m_inode * dir,
 	const char * name, int namelen, struct dir_entry ** res_dir)
 {
-	int block,i;
+	int block,i,n;
 	struct buffer_head * bh;
 	struct dir_entry * de;
 
@@ -242,6 +316,31 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 		return NULL;
 	if (!(block = dir->i_zone[0]))
 		return NULL;
+	/*
+	 * 有哈希索引时直接取空闲项，没有空闲项时追加
+	 * 空闲项在目录中间，i为0不会改变目录长度
+	 */
+	if ((n = dindex_slot(dir, &block)) >= 0) {
+		i = 0;
+		if (!block) {
+			i = n;
+			n %= DIR_ENTRIES_PER_BLOCK;
+			block = create_block(dir, i/DIR_ENTRIES_PER_BLOCK);
+		}
+		if (!block || !(bh = bread(dir->i_dev, block))) {
+			dindex_purge(dir->i_dev, dir->i_num);
+			return NULL;
+		}
+		de = n + (struct dir_entry *) bh->b_data;
+		if (!de->inode || i*sizeof(struct dir_entry) >= dir->i_size)
+			goto found;
+		/*
+		 * 索引和目录不一致，放弃索引，线性查找
+		 */
+		brelse(bh);
+		dindex_purge(dir->i_dev, dir->i_num);
+		block = dir->i_zone[0];
+	}
 	if (!(bh = bread(dir->i_dev, block)))
 		return NULL;
 	i = 0;
@@ -259,29 +358,32 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 			}
 			de = (struct dir_entry *) bh->b_data;
 		}
-		/*
-		 * 如果i*sizeof(struct dir_entry) >= dir->i_size
-		 * 说明这个i所在的entry可以用
-		 */
-		if (i*sizeof(struct dir_entry) >= dir->i_size) {
-			de->inode=0;
-			dir->i_size = (i+1)*sizeof(struct dir_entry);
-			dir->i_dirt = 1;
-			dir->i_ctime = CURRENT_TIME;
-		}
-		if (!de->inode) {
-			dir->i_mtime = CURRENT_TIME;
-			for (i=0; i < NAME_LEN ; i++)
-				de->name[i]=(i<namelen)?get_fs_byte(name+i):0;
-			bh->b_dirt = 1;
-			*res_dir = de;
-			return bh;
-		}
+		if (i*sizeof(struct dir_entry) >= dir->i_size || !de->inode)
+			break;
 		de++;
 		i++;
 	}
-	brelse(bh);
-	return NULL;
+	/*
+	 * 没有使用索引，睡眠期间其他进程可能建立了索引，这一项在其中是空闲的
+	 */
+	dindex_purge(dir->i_dev, dir->i_num);
+found:
+	/*
+	 * 如果i*sizeof(struct dir_entry) >= dir->i_size
+	 * 说明这个i所在的entry可以用
+	 */
+	if (i*sizeof(struct dir_entry) >= dir->i_size) {
+		de->inode=0;
+		dir->i_size = (i+1)*sizeof(struct dir_entry);
+		dir->i_dirt = 1;
+		dir->i_ctime = CURRENT_TIME;
+	}
+	dir->i_mtime = CURRENT_TIME;
+	for (i=0; i < NAME_LEN ; i++)
+		de->name[i]=(i<namelen)?get_fs_byte(name+i):0;
+	bh->b_dirt = 1;
+	*res_dir = de;
+	return bh;
 }
 
 /*
@@ -299,9 +401,7 @@ static struct m_inode * get_dir(const char * pathname)
 	char c;
 	const char * thisname;
 	struct m_inode * inode;
-	struct buffer_head * bh;
 	int namelen, inr, idev;
-	struct dir_entry * de;
 
 	/*
 	 * 如果当前进程没有设定根i节点或者计数为0，panic
@@ -371,13 +471,11 @@ static struct m_inode * get_dir(const char * pathname)
 		 *
 		 */
 	
-		if (!(bh = find_entry(&inode, thisname, namelen, &de))) {
+		if (!(inr = lookup(&inode, thisname, namelen))) {
 			iput(inode);
 			return NULL;
 		}
-		inr = de->inode;
 		idev = inode->i_dev;
-		brelse(bh);
 		iput(inode);
 		if (!(inode = iget(idev, inr))) {
 			return NULL;
@@ -431,21 +529,16 @@ struct m_inode * namei(const char * pathname)
 	const char * basename;
 	int inr,dev,namelen;
 	struct m_inode * dir;
-	struct buffer_head * bh;
-	struct dir_entry * de;
 
 	if (!(dir = dir_namei(pathname,&namelen,&basename)))
 		return NULL;
 	if (!namelen)			/* special case: '/usr/' etc */
 		return dir;
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
+	if (!(inr = lookup(&dir,basename,namelen))) {
 		iput(dir);
 		return NULL;
 	}
-	inr = de->inode;
 	dev = dir->i_dev;
-	brelse(bh);
 	iput(dir);
 	dir=iget(dev,inr);
 	if (dir) {
@@ -509,8 +602,7 @@ int open_namei(const char * pathname, int flag, int mode,
 		iput(dir);
 		return -EISDIR;
 	}
-	bh = find_entry(&dir, basename, namelen, &de);
-	if (!bh) {
+	if (!(inr = lookup(&dir, basename, namelen))) {
 		if (!(flag & O_CREAT)) {
 			iput(dir);
 			return -ENOENT;
@@ -536,14 +628,14 @@ int open_namei(const char * pathname, int flag, int mode,
 		}
 		de->inode = inode->i_num;
 		bh->b_dirt = 1;
+		dindex_insert(dir, bh, de);
+		forget_entry(dir, basename, namelen);
 		brelse(bh);
 		iput(dir);
 		*res_inode = inode;
 		return 0;
 	}
-	inr = de->inode;
 	dev = dir->i_dev;
-	brelse(bh);
 	iput(dir);
 	if (flag & O_EXCL)
 		return -EEXIST;
@@ -625,6 +717,8 @@ int sys_mknod(const char * filename, int mode, int dev)
 	}
 	de->inode = inode->i_num;
 	bh->b_dirt = 1;
+	dindex_insert(dir, bh, de);
+	forget_entry(dir, basename, namelen);
 	iput(dir);
 	iput(inode);
 	brelse(bh);
@@ -694,7 +788,7 @@ int sys_mkdir(const char * pathname, int mode)
 	/*
 	 * new_block返回实际的块索引并将块索引对应的块清零
 	 */
-	if (!(inode->i_zone[0] = new_block(inode->i_dev))) {
+	if (!(inode->i_zone[0] = new_file_block(inode, 0))) {
 		iput(dir);
 		inode->i_nlinks--;
 		iput(inode);
@@ -732,6 +826,8 @@ int sys_mkdir(const char * pathname, int mode)
 	}
 	de->inode = inode->i_num;
 	bh->b_dirt = 1;
+	dindex_insert(dir, bh, de);
+	forget_entry(dir, basename, namelen);
 	dir->i_nlinks++;
 	dir->i_dirt = 1;
 	iput(dir);
@@ -852,7 +948,11 @@ int sys_rmdir(const char * name)
 		printk("empty directory has nlink!=2 (%d)",inode->i_nlinks);
 	de->inode = 0;
 	bh->b_dirt = 1;
+	dindex_remove(dir, bh, de);
 	brelse(bh);
+	forget_entry(dir,basename,namelen);
+	dcache_purge(inode->i_dev,inode->i_num);
+	dindex_purge(inode->i_dev,inode->i_num);
 	inode->i_nlinks=0;
 	inode->i_dirt=1;
 	dir->i_nlinks--;
@@ -912,7 +1012,9 @@ int sys_unlink(const char * name)
 	}
 	de->inode = 0;
 	bh->b_dirt = 1;
+	dindex_remove(dir, bh, de);
 	brelse(bh);
+	forget_entry(dir,basename,namelen);
 	inode->i_nlinks--;
 	inode->i_dirt = 1;
 	inode->i_ctime = CURRENT_TIME;
@@ -976,6 +1078,8 @@ int sys_link(const char * oldname, const char * newname)
 	}
 	de->inode = oldinode->i_num;
 	bh->b_dirt = 1;
+	dindex_insert(dir, bh, de);
+	forget_entry(dir, basename, namelen);
 	brelse(bh);
 	iput(dir);
 	oldinode->i_nlinks++;
@@ -10,15 +10,57 @@
 #include <sys/types.h>
 #include <utime.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
 
 #include <linux/sched.h>
 #include <linux/tty.h>
 #include <linux/kernel.h>
 #include <asm/segment.h>
 
+/*
+ * 空闲数直接取超级块中的计数，dev必须是已经安装的设备
+ */
 int sys_ustat(int dev, struct ustat * ubuf)
 {
-	return -ENOSYS;
+	struct super_block * sb;
+	int i;
+
+	if (!(sb = get_super(dev)))
+		return -EINVAL;
+	verify_area(ubuf, sizeof *ubuf);
+	put_fs_long(sb->s_free_zones, (unsigned long *) &ubuf->f_tfree);
+	put_fs_word(sb->s_free_inodes, (short *) &ubuf->f_tinode);
+	for (i = 0 ; i < 6 ; i++) {
+		put_fs_byte(0, ubuf->f_fname + i);
+		put_fs_byte(0, ubuf->f_fpack + i);
+	}
+	return 0;
+}
+
+int sys_statfs(const char * path, struct statfs * buf)
+{
+	struct m_inode * inode;
+	struct super_block * sb;
+	struct statfs tmp;
+
+	if (!(inode = namei(path)))
+		return -ENOENT;
+	sb = get_super(inode->i_dev);
+	iput(inode);
+	if (!sb)
+		return -ENODEV;
+	tmp.f_type = sb->s_magic;
+	tmp.f_bsize = BLOCK_SIZE << sb->s_log_zone_size;
+	tmp.f_blocks = sb->s_nzones - sb->s_firstdatazone;
+	tmp.f_bfree = tmp.f_bavail = sb->s_free_zones;
+	tmp.f_files = sb->s_ninodes;
+	tmp.f_ffree = sb->s_free_inodes;
+	tmp.f_fsid = sb->s_dev;
+	tmp.f_namelen = NAME_LEN;
+	verify_area(buf, sizeof *buf);
+	if (copy_to_user(buf, &tmp, sizeof tmp))
+		return -EFAULT;
+	return 0;
 }
 
 int sys_utime(char * filename, struct utimbuf * times)
@@ -226,6 +268,8 @@ int sys_open(const char * filename, int flag, int mode)
 	f->f_count = 1;
 	f->f_inode = inode;
 	f->f_pos = 0;
+	f->f_ra_next = 0;
+	f->f_ra_end = f->f_ra_size = 0;
 
 	return (fd);
 }
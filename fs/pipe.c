@@ -5,14 +5,19 @@
  */
 
 #include <signal.h>
+#include <errno.h>
 
 #include <linux/sched.h>
 #include <linux/mm.h>	/* for get_free_page */
 #include <asm/segment.h>
 
+/*
+ * 用户地址出错时返回已经完成的字节数，没有复制的部分在其他进程还没有
+ * 移动管道指针时退回
+ */
 int read_pipe(struct m_inode * inode, char * buf, int count)
 {
-	int chars, size, read = 0;
+	int chars, size, left, read = 0;
 
 	while (count>0) {
 		while (!(size=PIPE_SIZE(*inode))) {
@@ -31,8 +36,15 @@ int read_pipe(struct m_inode * inode, char * buf, int count)
 		size = PIPE_TAIL(*inode);
 		PIPE_TAIL(*inode) += chars;
 		PIPE_TAIL(*inode) &= (PAGE_SIZE-1);
-		while (chars-->0)
-			put_fs_byte(((char *)inode->i_size)[size++],buf++);
+		if ((left = copy_to_user(buf, size + (char *)inode->i_size, chars))) {
+			if (PIPE_TAIL(*inode) == ((size + chars) & (PAGE_SIZE-1)))
+				PIPE_TAIL(*inode) = (PIPE_TAIL(*inode) - left) & (PAGE_SIZE-1);
+			read -= left;
+			if (!read)
+				read = -EFAULT;
+			break;
+		}
+		buf += chars;
 	}
 	wake_up(&inode->i_wait);
 	return read;
@@ -40,7 +52,7 @@ int read_pipe(struct m_inode * inode, char * buf, int count)
 	
 int write_pipe(struct m_inode * inode, char * buf, int count)
 {
-	int chars, size, written = 0;
+	int chars, size, left, written = 0;
 
 	while (count>0) {
 		while (!(size=(PAGE_SIZE-1)-PIPE_SIZE(*inode))) {
@@ -61,13 +73,38 @@ int write_pipe(struct m_inode * inode, char * buf, int count)
 		size = PIPE_HEAD(*inode);
 		PIPE_HEAD(*inode) += chars;
 		PIPE_HEAD(*inode) &= (PAGE_SIZE-1);
-		while (chars-->0)
-			((char *)inode->i_size)[size++]=get_fs_byte(buf++);
+		if ((left = copy_from_user(size + (char *)inode->i_size, buf, chars))) {
+			if (PIPE_HEAD(*inode) == ((size + chars) & (PAGE_SIZE-1)))
+				PIPE_HEAD(*inode) = (PIPE_HEAD(*inode) - left) & (PAGE_SIZE-1);
+			written -= left;
+			if (!written)
+				written = -EFAULT;
+			break;
+		}
+		buf += chars;
 	}
 	wake_up(&inode->i_wait);
 	return written;
 }
 
+/*
+ * 管道的另一端关闭时也认为就绪，这时读返回0，写返回错误
+ */
+int pipe_select(struct m_inode * inode, int flag, struct select_table * wait)
+{
+	int mask = 0;
+
+	if (inode->i_count != 2)
+		return flag & (SEL_IN | SEL_OUT);
+	if (!PIPE_EMPTY(*inode))
+		mask |= SEL_IN;
+	if (!PIPE_FULL(*inode))
+		mask |= SEL_OUT;
+	if (!(mask &= flag) && (flag & (SEL_IN | SEL_OUT)))
+		select_wait(&inode->i_wait, wait);
+	return mask;
+}
+
 int sys_pipe(unsigned long * fildes)
 {
 	struct m_inode * inode;
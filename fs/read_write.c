@@ -7,6 +7,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <linux/kernel.h>
 #include <linux/sched.h>
@@ -18,9 +19,9 @@ extern int write_pipe(struct m_inode * inode, char * buf, int count);
 extern int block_read(int dev, off_t * pos, char * buf, int count);
 extern int block_write(int dev, off_t * pos, char * buf, int count);
 extern int file_read(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
+		off_t * pos, struct iovec * iov, int count);
 extern int file_write(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
+		off_t * pos, struct iovec * iov, int count);
 
 int sys_lseek(unsigned int fd,off_t offset, int origin)
 {
@@ -52,52 +53,227 @@ int sys_lseek(unsigned int fd,off_t offset, int origin)
 	return file->f_pos;
 }
 
-int sys_read(unsigned int fd,char * buf,int count)
+/*
+ * 管道和设备一次只处理一个缓冲区
+ */
+static int rw_one(int rw, struct file * file, char * buf, int count, off_t * pos)
 {
-	struct file * file;
-	struct m_inode * inode;
+	struct m_inode * inode = file->f_inode;
 
-	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
-		return -EINVAL;
-	if (!count)
-		return 0;
-	verify_area(buf,count);
-	inode = file->f_inode;
 	if (inode->i_pipe)
-		return (file->f_mode&1)?read_pipe(inode,buf,count):-EIO;
+		return (rw==READ)?read_pipe(inode,buf,count):
+			write_pipe(inode,buf,count);
 	if (S_ISCHR(inode->i_mode))
-		return rw_char(READ,inode->i_zone[0],buf,count,&file->f_pos);
-	if (S_ISBLK(inode->i_mode))
-		return block_read(inode->i_zone[0],&file->f_pos,buf,count);
-	if (S_ISDIR(inode->i_mode) || S_ISREG(inode->i_mode)) {
-		if (count+file->f_pos > inode->i_size)
-			count = inode->i_size - file->f_pos;
+		return rw_char(rw,inode->i_zone[0],buf,count,pos);
+	return (rw==READ)?block_read(inode->i_zone[0],pos,buf,count):
+		block_write(inode->i_zone[0],pos,buf,count);
+}
+
+/*
+ * read/write/readv/writev/pread/pwrite的公共部分，iov已经复制到内核中
+ * pos为NULL时使用并更新文件的当前位置，否则是pread/pwrite指定的位置，
+ * 这时管道和终端等不能定位的设备返回ESPIPE
+ * 普通文件一次处理所有的iov，管道和设备每个iov调用一次，传输不足时停止
+ */
+static int rw_iov(int rw, struct file * file, struct iovec * iov, int nr, off_t * pos)
+{
+	struct m_inode * inode = file->f_inode;
+	int i, count = 0, done = 0, ret;
+
+	for (i = 0 ; i < nr ; i++) {
+		if ((int) iov[i].iov_len < 0 || count + (int) iov[i].iov_len < 0)
+			return -EINVAL;
+		count += iov[i].iov_len;
+		if (rw == READ)
+			verify_area(iov[i].iov_base, iov[i].iov_len);
+	}
+	if (!count)
+		return 0;
+	if (pos && (inode->i_pipe || (S_ISCHR(inode->i_mode) &&
+	    !IS_SEEKABLE(MAJOR(inode->i_zone[0])))))
+		return -ESPIPE;
+	if (!pos)
+		pos = &file->f_pos;
+	if (inode->i_pipe) {
+		if (!(file->f_mode & ((rw==READ)?1:2)))
+			return -EIO;
+	} else if (rw == READ && (S_ISDIR(inode->i_mode) || S_ISREG(inode->i_mode))) {
+		if (count + *pos > inode->i_size)
+			count = inode->i_size - *pos;
 		if (count<=0)
 			return 0;
-		return file_read(inode,file,buf,count);
+		return file_read(inode,file,pos,iov,count);
+	} else if (rw == WRITE && S_ISREG(inode->i_mode))
+		return file_write(inode,file,pos,iov,count);
+	else if (!S_ISCHR(inode->i_mode) && !S_ISBLK(inode->i_mode)) {
+		printk((rw==READ)?"(Read)inode->i_mode=%06o\n\r":
+			"(Write)inode->i_mode=%06o\n\r",inode->i_mode);
+		return -EINVAL;
+	}
+	for (i = 0 ; i < nr ; i++) {
+		if (!iov[i].iov_len)
+			continue;
+		ret = rw_one(rw,file,iov[i].iov_base,iov[i].iov_len,pos);
+		if (ret < 0)
+			return done?done:ret;
+		done += ret;
+		if (ret < iov[i].iov_len)
+			break;
 	}
-	printk("(Read)inode->i_mode=%06o\n\r",inode->i_mode);
-	return -EINVAL;
+	return done;
+}
+
+int sys_read(unsigned int fd,char * buf,int count)
+{
+	struct file * file;
+	struct iovec iov;
+
+	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
+		return -EINVAL;
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	return rw_iov(READ,file,&iov,1,NULL);
 }
 
 int sys_write(unsigned int fd,char * buf,int count)
 {
 	struct file * file;
-	struct m_inode * inode;
+	struct iovec iov;
 	
 	if (fd>=NR_OPEN || count <0 || !(file=current->filp[fd]))
 		return -EINVAL;
-	if (!count)
-		return 0;
-	inode=file->f_inode;
-	if (inode->i_pipe)
-		return (file->f_mode&2)?write_pipe(inode,buf,count):-EIO;
-	if (S_ISCHR(inode->i_mode))
-		return rw_char(WRITE,inode->i_zone[0],buf,count,&file->f_pos);
-	if (S_ISBLK(inode->i_mode))
-		return block_write(inode->i_zone[0],&file->f_pos,buf,count);
-	if (S_ISREG(inode->i_mode))
-		return file_write(inode,file,buf,count);
-	printk("(Write)inode->i_mode=%06o\n\r",inode->i_mode);
-	return -EINVAL;
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	return rw_iov(WRITE,file,&iov,1,NULL);
+}
+
+static int do_readv_writev(int rw, unsigned int fd, struct iovec * uiov, int iovcnt)
+{
+	struct file * file;
+	struct iovec iov[UIO_MAXIOV];
+
+	if (fd>=NR_OPEN || !(file=current->filp[fd]))
+		return -EBADF;
+	if (iovcnt <= 0 || iovcnt > UIO_MAXIOV)
+		return -EINVAL;
+	if (copy_from_user(iov, uiov, iovcnt * sizeof (struct iovec)))
+		return -EFAULT;
+	return rw_iov(rw,file,iov,iovcnt,NULL);
+}
+
+int sys_readv(unsigned int fd, struct iovec * iov, int iovcnt)
+{
+	return do_readv_writev(READ,fd,iov,iovcnt);
+}
+
+int sys_writev(unsigned int fd, struct iovec * iov, int iovcnt)
+{
+	return do_readv_writev(WRITE,fd,iov,iovcnt);
+}
+
+/*
+ * 系统调用最多3个参数，buf和count放在一个iovec中传递
+ * 不使用也不改变文件的当前位置
+ */
+static int do_pread_pwrite(int rw, unsigned int fd, struct iovec * uiov, off_t offset)
+{
+	struct file * file;
+	struct iovec iov;
+
+	if (fd>=NR_OPEN || !(file=current->filp[fd]))
+		return -EBADF;
+	if (offset < 0)
+		return -EINVAL;
+	if (copy_from_user(&iov, uiov, sizeof iov))
+		return -EFAULT;
+	return rw_iov(rw,file,&iov,1,&offset);
+}
+
+/*
+ * 从普通文件直接发送到另一个文件，管道或者终端，不经过用户空间
+ * 把fs设置为内核数据段，目的端的写函数就可以直接从缓冲块中取数据，
+ * 和exec中from_kmem的做法一样，数据只复制一次
+ * 参数超过3个，和select一样通过buffer传递：
+ * buffer[0]=out_fd, [1]=in_fd, [2]=offset, [3]=count
+ * offset为NULL时使用并更新in_fd的当前位置，否则从*offset开始，结束后写回
+ */
+int sys_sendfile(unsigned long * buffer)
+{
+	static char zero_block[BLOCK_SIZE];
+	struct file * in, * out;
+	struct m_inode * inode;
+	struct buffer_head * bh;
+	struct iovec iov;
+	unsigned long old_fs;
+	off_t * offset, pos;
+	int out_fd, in_fd, count, chars, nr, next, ret = 0, written = 0;
+
+	out_fd = get_fs_long(buffer);
+	in_fd = get_fs_long(buffer+1);
+	offset = (off_t *) get_fs_long(buffer+2);
+	count = get_fs_long(buffer+3);
+	if (out_fd>=NR_OPEN || !(out=current->filp[out_fd]) ||
+	    in_fd>=NR_OPEN || !(in=current->filp[in_fd]))
+		return -EBADF;
+	inode = in->f_inode;
+	if (!S_ISREG(inode->i_mode) || !(in->f_mode & 1) || count < 0)
+		return -EINVAL;
+	if (!(out->f_mode & 2))
+		return -EBADF;
+	pos = offset ? (off_t) get_fs_long((unsigned long *) offset) : in->f_pos;
+	if (pos < 0)
+		return -EINVAL;
+	while (count > 0 && pos < inode->i_size) {
+		chars = BLOCK_SIZE - pos % BLOCK_SIZE;
+		if (chars > count)
+			chars = count;
+		if (chars > inode->i_size - pos)
+			chars = inode->i_size - pos;
+		bh = NULL;
+		if ((nr = bmap(inode,pos/BLOCK_SIZE))) {
+			next = -1;
+			if (pos/BLOCK_SIZE+1 < (inode->i_size+BLOCK_SIZE-1)/BLOCK_SIZE &&
+			    !(next = bmap(inode,pos/BLOCK_SIZE+1)))
+				next = -1;
+			if (!(bh = breada(inode->i_dev,nr,next,-1))) {
+				ret = -EIO;
+				break;
+			}
+			iov.iov_base = pos % BLOCK_SIZE + bh->b_data;
+		} else
+			iov.iov_base = zero_block;
+		iov.iov_len = chars;
+		old_fs = get_fs();
+		set_fs(get_ds());
+		ret = rw_iov(WRITE,out,&iov,1,NULL);
+		set_fs(old_fs);
+		if (bh)
+			brelse(bh);
+		if (ret <= 0)
+			break;
+		pos += ret;
+		written += ret;
+		count -= ret;
+		if (ret < chars)
+			break;
+	}
+	inode->i_atime = CURRENT_TIME;
+	if (offset) {
+		verify_area(offset, sizeof *offset);
+		put_fs_long(pos, (unsigned long *) offset);
+	} else
+		in->f_pos = pos;
+	if (!written && count > 0 && pos < inode->i_size)
+		return ret;
+	return written;
+}
+
+int sys_pread(unsigned int fd, struct iovec * iov, off_t offset)
+{
+	return do_pread_pwrite(READ,fd,iov,offset);
+}
+
+int sys_pwrite(unsigned int fd, struct iovec * iov, off_t offset)
+{
+	return do_pread_pwrite(WRITE,fd,iov,offset);
 }
@@ -0,0 +1,337 @@
+/*
+ *  linux/fs/select.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * select和poll
+ *
+ * sleep_on的等待队列是串在各个进程栈上的链，一个进程不能同时挂在多个链上，
+ * 所以select/poll的进程登记在select_entry表中，wake_up时扫描这个表，
+ * 只有对象的状态变化（调用了wake_up）时才唤醒
+ *
+ * 每种对象自己判断是否就绪：tty_select, pipe_select，
+ * 普通文件，块设备和其他字符设备读写不会阻塞，总是就绪
+ *
+ * 超时和nanosleep一样使用current->timeout，由schedule检查
+ */
+#include <errno.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/times.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/tty.h>
+#include <linux/time.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define NR_SELECT_WAIT	128
+
+static struct {
+	struct task_struct ** wait_address;
+	struct task_struct * task;
+} select_entry[NR_SELECT_WAIT];
+
+int nr_select_wait = 0;
+
+/*
+ * 一次select/poll中需要检查的描述符
+ */
+struct poll_entry {
+	int fd;
+	int flag;
+	int mask;
+};
+
+/*
+ * 表满时不登记，select/poll改为每个滴答检查一次
+ */
+void select_wait(struct task_struct ** wait_address, struct select_table * wait)
+{
+	int i, free = -1;
+
+	if (!wait || !wait_address)
+		return;
+	cli();
+	for (i = 0 ; i < NR_SELECT_WAIT ; i++) {
+		if (!select_entry[i].task) {
+			if (free < 0)
+				free = i;
+		} else if (select_entry[i].task == current &&
+			   select_entry[i].wait_address == wait_address) {
+			sti();
+			return;
+		}
+	}
+	if (free < 0) {
+		wait->overflow = 1;
+		sti();
+		return;
+	}
+	select_entry[free].wait_address = wait_address;
+	select_entry[free].task = current;
+	wait->nr++;
+	nr_select_wait++;
+	sti();
+}
+
+static void free_wait(struct select_table * wait)
+{
+	int i;
+
+	if (!wait->nr)
+		return;
+	cli();
+	for (i = 0 ; i < NR_SELECT_WAIT ; i++)
+		if (select_entry[i].task == current) {
+			select_entry[i].task = NULL;
+			select_entry[i].wait_address = NULL;
+			nr_select_wait--;
+		}
+	sti();
+	wait->nr = 0;
+}
+
+/*
+ * 由wake_up调用，可能在中断中
+ */
+void wake_up_select(struct task_struct ** p)
+{
+	struct task_struct * task;
+	int i;
+
+	for (i = 0 ; i < NR_SELECT_WAIT ; i++)
+		if (select_entry[i].wait_address == p &&
+		    (task = select_entry[i].task) &&
+		    task->state == TASK_INTERRUPTIBLE)
+			task->state = TASK_RUNNING;
+}
+
+static int check_fd(int fd, int flag, struct select_table * wait)
+{
+	struct m_inode * inode = current->filp[fd]->f_inode;
+	int dev;
+
+	if (!inode)
+		return flag & (SEL_IN | SEL_OUT);
+	if (inode->i_pipe)
+		return pipe_select(inode, flag, wait);
+	if (S_ISCHR(inode->i_mode)) {
+		dev = inode->i_zone[0];
+		if (MAJOR(dev) == 4)
+			return tty_select(MINOR(dev), flag, wait);
+		if (MAJOR(dev) == 5 && current->tty >= 0)
+			return tty_select(current->tty, flag, wait);
+	}
+	return flag & (SEL_IN | SEL_OUT);
+}
+
+/*
+ * 检查所有描述符，都没有就绪时睡眠，直到被对象唤醒，超时或者有信号
+ * timeout为滴答数，-1表示一直等待，0表示不等待
+ * 已经有描述符就绪时后面的就不需要再登记了
+ */
+static int do_poll(struct poll_entry * table, int nr, long timeout)
+{
+	struct select_table wait_table;
+	long expire = 0;
+	int i, count;
+
+	if (timeout > 0)
+		expire = jiffies + timeout;
+	wait_table.nr = 0;
+	while (1) {
+		wait_table.overflow = 0;
+		current->state = TASK_INTERRUPTIBLE;
+		count = 0;
+		for (i = 0 ; i < nr ; i++) {
+			table[i].mask = 0;
+			if (!table[i].flag)
+				continue;
+			table[i].mask = check_fd(table[i].fd, table[i].flag,
+				(count || !timeout) ? NULL : &wait_table);
+			if (table[i].mask)
+				count++;
+		}
+		if (count || !timeout || (expire && expire < jiffies))
+			break;
+		if (current->signal & ~current->blocked) {
+			count = -EINTR;
+			break;
+		}
+		current->timeout = expire;
+		if (wait_table.overflow && (!expire || expire > jiffies + 1))
+			current->timeout = jiffies + 1;
+		if (current->timeout &&
+		    (!next_timeout || current->timeout < next_timeout))
+			next_timeout = current->timeout;
+		schedule();
+		current->timeout = 0;
+		free_wait(&wait_table);
+	}
+	current->state = TASK_RUNNING;
+	free_wait(&wait_table);
+	return count;
+}
+
+/*
+ * 参数超过3个，和老的Linux一样通过buffer传递
+ * buffer[0]=n, [1]=readfds, [2]=writefds, [3]=exceptfds, [4]=timeout
+ */
+int sys_select(unsigned long * buffer)
+{
+	struct poll_entry table[NR_OPEN];
+	fd_set * inp, * outp, * exp;
+	fd_set in = 0, out = 0, ex = 0;
+	struct timeval * tvp, tv;
+	unsigned long args[5];
+	long timeout = -1, expire = 0;
+	int n, i, nr = 0, count;
+
+	if (copy_from_user(args, buffer, sizeof args))
+		return -EFAULT;
+	n = args[0];
+	inp = (fd_set *) args[1];
+	outp = (fd_set *) args[2];
+	exp = (fd_set *) args[3];
+	tvp = (struct timeval *) args[4];
+	if (n < 0)
+		return -EINVAL;
+	if (n > NR_OPEN)
+		n = NR_OPEN;
+	if ((inp && copy_from_user(&in, inp, sizeof in)) ||
+	    (outp && copy_from_user(&out, outp, sizeof out)) ||
+	    (exp && copy_from_user(&ex, exp, sizeof ex)))
+		return -EFAULT;
+	if (tvp) {
+		if (copy_from_user(&tv, tvp, sizeof tv))
+			return -EFAULT;
+		if (tv.tv_sec < 0 || tv.tv_usec < 0 || tv.tv_usec >= 1000000)
+			return -EINVAL;
+		if (tv.tv_sec > 0x7fffffff / HZ - 1)
+			tv.tv_sec = 0x7fffffff / HZ - 1;
+		timeout = tv.tv_sec * HZ + (tv.tv_usec + 1000000/HZ - 1) / (1000000/HZ);
+	}
+	for (i = 0 ; i < n ; i++) {
+		table[nr].flag = 0;
+		if (FD_ISSET(i, &in))
+			table[nr].flag |= SEL_IN;
+		if (FD_ISSET(i, &out))
+			table[nr].flag |= SEL_OUT;
+		if (FD_ISSET(i, &ex))
+			table[nr].flag |= SEL_EX;
+		if (!table[nr].flag)
+			continue;
+		if (!current->filp[i])
+			return -EBADF;
+		table[nr++].fd = i;
+	}
+	if (timeout > 0)
+		expire = jiffies + timeout;
+	count = do_poll(table, nr, timeout);
+	if (count < 0)
+		return count;
+	in = out = ex = 0;
+	for (i = 0 ; i < nr ; i++) {
+		if (table[i].mask & SEL_IN)
+			FD_SET(table[i].fd, &in);
+		if (table[i].mask & SEL_OUT)
+			FD_SET(table[i].fd, &out);
+		if (table[i].mask & SEL_EX)
+			FD_SET(table[i].fd, &ex);
+	}
+	if (inp) {
+		verify_area(inp, sizeof *inp);
+		if (copy_to_user(inp, &in, sizeof in))
+			return -EFAULT;
+	}
+	if (outp) {
+		verify_area(outp, sizeof *outp);
+		if (copy_to_user(outp, &out, sizeof out))
+			return -EFAULT;
+	}
+	if (exp) {
+		verify_area(exp, sizeof *exp);
+		if (copy_to_user(exp, &ex, sizeof ex))
+			return -EFAULT;
+	}
+	/*
+	 * 返回剩余的时间
+	 */
+	if (tvp) {
+		timeout = expire - jiffies;
+		if (timeout < 0)
+			timeout = 0;
+		tv.tv_sec = timeout / HZ;
+		tv.tv_usec = (timeout % HZ) * (1000000/HZ);
+		verify_area(tvp, sizeof *tvp);
+		if (copy_to_user(tvp, &tv, sizeof tv))
+			return -EFAULT;
+	}
+	return count;
+}
+
+/*
+ * timeout单位为毫秒，负数表示一直等待
+ * 无效的描述符不算错误，在revents中返回POLLNVAL
+ */
+int sys_poll(struct pollfd * fds, unsigned int nfds, int timeout)
+{
+	struct poll_entry table[NR_OPEN];
+	int i, bad = 0, count, fd, events;
+	short revents;
+
+	if (nfds > NR_OPEN)
+		return -EINVAL;
+	verify_area(fds, nfds * sizeof (struct pollfd));
+	for (i = 0 ; i < nfds ; i++) {
+		fd = get_fs_long((unsigned long *) &fds[i].fd);
+		events = get_fs_word((unsigned short *) &fds[i].events);
+		table[i].fd = fd;
+		table[i].flag = 0;
+		if (fd < 0)
+			continue;
+		if (fd >= NR_OPEN || !current->filp[fd]) {
+			bad++;
+			continue;
+		}
+		if (events & POLLIN)
+			table[i].flag |= SEL_IN;
+		if (events & POLLOUT)
+			table[i].flag |= SEL_OUT;
+		if (events & POLLPRI)
+			table[i].flag |= SEL_EX;
+	}
+	if (timeout > 0) {
+		if (timeout > 0x7fffffff / HZ)
+			timeout = 0x7fffffff / HZ;
+		timeout = (timeout * HZ + 999) / 1000;
+	}
+	if (bad)
+		timeout = 0;
+	count = do_poll(table, nfds, timeout < 0 ? -1 : timeout);
+	if (count < 0)
+		return count;
+	for (i = 0 ; i < nfds ; i++) {
+		fd = table[i].fd;
+		if (fd < 0)
+			revents = 0;
+		else if (fd >= NR_OPEN || !current->filp[fd]) {
+			revents = POLLNVAL;
+			count++;
+		} else {
+			revents = 0;
+			if (table[i].mask & SEL_IN)
+				revents |= POLLIN;
+			if (table[i].mask & SEL_OUT)
+				revents |= POLLOUT;
+			if (table[i].mask & SEL_EX)
+				revents |= POLLPRI;
+		}
+		put_fs_word(revents, (short *) &fds[i].revents);
+	}
+	return count;
+}
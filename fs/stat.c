@@ -12,10 +12,9 @@
 #include <linux/kernel.h>
 #include <asm/segment.h>
 
-static void cp_stat(struct m_inode * inode, struct stat * statbuf)
+static int cp_stat(struct m_inode * inode, struct stat * statbuf)
 {
 	struct stat tmp;
-	int i;
 
 	verify_area(statbuf,sizeof (* statbuf));
 	tmp.st_dev = inode->i_dev;
@@ -29,30 +28,33 @@ static void cp_stat(struct m_inode * inode, struct stat * statbuf)
 	tmp.st_atime = inode->i_atime;
 	tmp.st_mtime = inode->i_mtime;
 	tmp.st_ctime = inode->i_ctime;
-	for (i=0 ; i<sizeof (tmp) ; i++)
-		put_fs_byte(((char *) &tmp)[i],&((char *) statbuf)[i]);
+	if (copy_to_user(statbuf, &tmp, sizeof (tmp)))
+		return -EFAULT;
+	return 0;
 }
 
 int sys_stat(char * filename, struct stat * statbuf)
 {
 	struct m_inode * inode;
+	int error;
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
-	cp_stat(inode,statbuf);
+	error = cp_stat(inode,statbuf);
 	iput(inode);
-	return 0;
+	return error;
 }
 
 int sys_lstat(char * filename, struct stat * statbuf)
 {
 	struct m_inode * inode;
+	int error;
 
 	if (!(inode = namei(filename)))
 		return -ENOENT;
-	cp_stat(inode,statbuf);
+	error = cp_stat(inode,statbuf);
 	iput(inode);
-	return 0;
+	return error;
 }
 
 int sys_fstat(unsigned int fd, struct stat * statbuf)
@@ -62,8 +64,7 @@ int sys_fstat(unsigned int fd, struct stat * statbuf)
 
 	if (fd >= NR_OPEN || !(f=current->filp[fd]) || !(inode=f->f_inode))
 		return -EBADF;
-	cp_stat(inode,statbuf);
-	return 0;
+	return cp_stat(inode,statbuf);
 }
 
 int sys_readlink(const char * path, char * buf, int bufsiz)
@@ -230,6 +230,7 @@ static struct super_block * read_super(int dev)
 	 */
 	s->s_imap[0]->b_data[0] |= 1;
 	s->s_zmap[0]->b_data[0] |= 1;
+	count_free(s);
 	free_super(s);
 	return s;
 }
@@ -254,9 +255,8 @@ int sys_umount(char * dev_name)
 		return -ENOENT;
 	if (!sb->s_imount->i_mount)
 		printk("Mounted inode has i_mount=0\n");
-	for (inode=inode_table+0 ; inode<inode_table+NR_INODE ; inode++)
-		if (inode->i_dev==dev && inode->i_count)
-				return -EBUSY;
+	if (!fs_may_umount(dev))
+		return -EBUSY;
 	sb->s_imount->i_mount=0;
 	iput(sb->s_imount);
 	sb->s_imount = NULL;
@@ -264,6 +264,8 @@ int sys_umount(char * dev_name)
 	sb->s_isup = NULL;
 	put_super(dev);
 	sync_dev(dev);
+	dcache_purge(dev,0);
+	dindex_purge(dev,0);
 	return 0;
 }
 
@@ -303,6 +305,8 @@ int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 		iput(dir_i);
 		return -EPERM;
 	}
+	dcache_purge(dev,0);
+	dindex_purge(dev,0);
 	sb->s_imount=dir_i;
 	dir_i->i_mount=1;
 	dir_i->i_dirt=1;		/* NOTE! we don't iput(dir_i) */
@@ -311,7 +315,7 @@ int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 
 void mount_root(void)
 {
-	int i,free;
+	int i;
 	struct super_block * p;
 	struct m_inode * mi;
 	struct buffer_head * bh;
@@ -386,41 +390,12 @@ void mount_root(void)
 		bh->b_data[2],bh->b_data[3]);
 	brelse(bh);
 
-	free=0;
 	/*
-	 * 统计该设备上的空闲块数，先让i等于该设备总的逻辑块数
-	 * s_nzones表示总逻辑块数包含了load，超级块等
-	 * s_zmap逻辑块位图缓冲块指针数组，8个块
-	 * s_ninodes表示节点数从1开始计数
-	 * s_imap节点位图缓冲块指针数组，8个块
-	 * 为什么是8191呢？
-	 * 因为一个高速缓冲区是1024个字节，共8192位
-	 * i&8191算的是在高速缓冲区的偏移，而i>>13是使用哪个高速缓存作为索引
-	 * 下面inodes是一样的道理
-	 * 每一个bit代表一个块，一共8192*8个bit，一个块1K
-	 * minix文件系统一共可管理8192*8*1K = 64M
-	 * minix文件系统最大64M
-	 * inode代表一个文件或者文件夹
-	 *
-	 *
-	 */
-	i = p->s_nzones;
-	while (--i >= 0)
-		if (!test_bit(i&8191, p->s_zmap[i>>13]->b_data))
-			free++;
-	printk("%s %d/%d free blocks\n\r", __func__, free, p->s_nzones);
-	/*
-	 * 重置free，计算inode
-	 * p->s_ninodes是从1开始计数的
-	 * 虽然bit0没有对应的inode结构，但还是统计上
-	 * 
+	 * 空闲块数和空闲i节点数在read_super时已经统计好
 	 */
-	free=0;
-	i = p->s_ninodes + 1;
-	while (--i >= 0)
-		if (!test_bit(i&8191,p->s_imap[i>>13]->b_data))
-			free++;
-	printk("%s %d/%d free inodes\n\r", __func__, free, p->s_ninodes);
+	printk("%s %d/%d free blocks\n\r", __func__, p->s_free_zones,
+		p->s_nzones - p->s_firstdatazone);
+	printk("%s %d/%d free inodes\n\r", __func__, p->s_free_inodes, p->s_ninodes);
 	printk("%s %d is firstdatazone\n\r", __func__, p->s_firstdatazone);
 }
 
@@ -0,0 +1,91 @@
+#ifndef _ASM_APIC_H
+#define _ASM_APIC_H
+
+/*
+ * Local APIC和IO-APIC的寄存器定义
+ *
+ * 两者都被映射到线性地址0xFFC00000开始的最后一个4MB（页目录第1023项），
+ * 使用内核数据段(基地址0xC0000000)访问时偏移为0x3FC00000，
+ * 因此SMP内核的代码段和数据段长度需要扩展到1GB，见head.s
+ */
+#define APIC_VIRT_BASE		0x3FC00000
+#define IO_APIC_VIRT_BASE	(APIC_VIRT_BASE+0x1000)
+
+#define APIC_DEFAULT_PHYS_BASE		0xFEE00000
+#define IO_APIC_DEFAULT_PHYS_BASE	0xFEC00000
+
+/* Local APIC寄存器偏移 */
+#define APIC_ID		0x020
+#define APIC_LVR	0x030
+#define APIC_TASKPRI	0x080
+#define APIC_EOI	0x0B0
+#define APIC_LDR	0x0D0
+#define APIC_DFR	0x0E0
+#define APIC_SPIV	0x0F0
+#define APIC_ESR	0x280
+#define APIC_ICR	0x300
+#define APIC_ICR2	0x310
+#define APIC_LVTT	0x320
+#define APIC_LVT0	0x350
+#define APIC_LVT1	0x360
+#define APIC_LVTERR	0x370
+#define APIC_TMICT	0x380
+#define APIC_TMCCT	0x390
+#define APIC_TDCR	0x3E0
+
+/* SPIV */
+#define APIC_SPIV_ENABLE	0x100
+
+/* LVT */
+#define APIC_LVT_MASKED		0x10000
+#define APIC_LVT_TIMER_PERIODIC	0x20000
+#define APIC_DM_EXTINT		0x00700
+#define APIC_DM_NMI		0x00400
+
+/* ICR */
+#define APIC_DM_INIT		0x00500
+#define APIC_DM_STARTUP		0x00600
+#define APIC_ICR_BUSY		0x01000
+#define APIC_INT_ASSERT		0x04000
+#define APIC_INT_LEVELTRIG	0x08000
+#define APIC_DEST_ALLBUT	0xC0000
+
+/* TDCR: 除数16 */
+#define APIC_TDR_DIV_16		0x3
+
+/* IO-APIC寄存器 */
+#define IO_APIC_REGSEL		0x00
+#define IO_APIC_WIN		0x10
+#define IO_APIC_VERSION		0x01
+#define IO_APIC_REDTBL(n)	(0x10+2*(n))
+
+/*
+ * SMP使用的中断向量，放在0x80系统调用之后的高优先级区域
+ */
+#define APIC_TIMER_VECTOR	0xEF
+#define INVALIDATE_TLB_VECTOR	0xFD
+#define SPURIOUS_APIC_VECTOR	0xFF
+
+static inline unsigned long apic_read(unsigned long reg)
+{
+	return *((volatile unsigned long *)(APIC_VIRT_BASE+reg));
+}
+
+static inline void apic_write(unsigned long reg, unsigned long v)
+{
+	*((volatile unsigned long *)(APIC_VIRT_BASE+reg)) = v;
+}
+
+static inline unsigned long io_apic_read(unsigned long reg)
+{
+	*((volatile unsigned long *)(IO_APIC_VIRT_BASE+IO_APIC_REGSEL)) = reg;
+	return *((volatile unsigned long *)(IO_APIC_VIRT_BASE+IO_APIC_WIN));
+}
+
+static inline void io_apic_write(unsigned long reg, unsigned long v)
+{
+	*((volatile unsigned long *)(IO_APIC_VIRT_BASE+IO_APIC_REGSEL)) = reg;
+	*((volatile unsigned long *)(IO_APIC_VIRT_BASE+IO_APIC_WIN)) = v;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _ASM_CPUID_H
+#define _ASM_CPUID_H
+
+/*
+ * cpuid leaf 1 中edx的特性位
+ */
+#define X86_FEATURE_TSC		(1<<4)
+#define X86_FEATURE_MSR		(1<<5)
+#define X86_FEATURE_SEP		(1<<11)
+
+/*
+ * 486以前的CPU没有cpuid指令，通过能否修改EFLAGS的ID位(bit21)判断
+ */
+static inline int has_cpuid(void)
+{
+	unsigned long f1, f2;
+
+	__asm__("pushfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"movl %0,%1\n\t"
+		"xorl $0x200000,%0\n\t"
+		"pushl %0\n\t"
+		"popfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"popfl"
+		:"=&r" (f1),"=&r" (f2));
+	return ((f1 ^ f2) & 0x200000) != 0;
+}
+
+static inline void cpuid(unsigned long op, unsigned long * eax,
+			 unsigned long * edx)
+{
+	__asm__("cpuid":"=a" (*eax),"=d" (*edx):"0" (op):"bx","cx");
+}
+
+static inline unsigned long cpuid_edx(unsigned long op)
+{
+	unsigned long eax, edx;
+
+	cpuid(op, &eax, &edx);
+	return edx;
+}
+
+#define rdtscl(low) \
+	__asm__ __volatile__("rdtsc":"=a" (low)::"dx")
+
+#define wrmsr(msr,lo,hi) \
+	__asm__ __volatile__("wrmsr"::"c" (msr),"a" (lo),"d" (hi))
+
+#endif
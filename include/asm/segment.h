@@ -63,3 +63,69 @@ static inline void set_fs(unsigned long val)
 	__asm__("mov %0,%%fs"::"a" ((unsigned short) val));
 }
 
+
+/*
+ * 批量复制，先用rep movsl按4字节复制，再用rep movsb复制剩下的字节
+ * 用户空间通过fs访问：copy_from_user给源操作数加fs前缀，
+ * copy_to_user的目的操作数只能是es，所以临时把es设置为fs
+ *
+ * 调用者需要先verify_area，和put_fs_xxx一样
+ * 地址超出段限长时产生一般保护异常，异常处理在__ex_table中找到出错的指令，
+ * 跳到.fixup中的修复代码，返回没有复制的字节数，成功时返回0
+ */
+struct exception_table_entry {
+	unsigned long insn, fixup;
+};
+
+extern unsigned long search_exception_table(unsigned long addr);
+
+static inline unsigned long copy_from_user(void * to, const void * from, unsigned long n)
+{
+	int d0, d1;
+
+	__asm__ __volatile__(
+		"0:\trep ; movsl %%fs:(%%esi),%%es:(%%edi)\n\t"
+		"movl %3,%0\n"
+		"1:\trep ; movsb %%fs:(%%esi),%%es:(%%edi)\n"
+		"2:\n"
+		".section .fixup,\"ax\"\n"
+		"3:\tlea 0(%3,%0,4),%0\n\t"
+		"jmp 2b\n"
+		".previous\n"
+		".section __ex_table,\"a\"\n\t"
+		".align 4\n\t"
+		".long 0b,3b\n\t"
+		".long 1b,2b\n"
+		".previous"
+		:"=&c" (n),"=&D" (d0),"=&S" (d1)
+		:"r" (n & 3),"0" (n / 4),"1" (to),"2" (from)
+		:"memory");
+	return n;
+}
+
+static inline unsigned long copy_to_user(void * to, const void * from, unsigned long n)
+{
+	int d0, d1;
+
+	__asm__ __volatile__(
+		"push %%es\n\t"
+		"push %%fs\n\t"
+		"pop %%es\n"
+		"0:\trep ; movsl\n\t"
+		"movl %3,%0\n"
+		"1:\trep ; movsb\n"
+		"2:\tpop %%es\n"
+		".section .fixup,\"ax\"\n"
+		"3:\tlea 0(%3,%0,4),%0\n\t"
+		"jmp 2b\n"
+		".previous\n"
+		".section __ex_table,\"a\"\n\t"
+		".align 4\n\t"
+		".long 0b,3b\n\t"
+		".long 1b,2b\n"
+		".previous"
+		:"=&c" (n),"=&D" (d0),"=&S" (d1)
+		:"r" (n & 3),"0" (n / 4),"1" (to),"2" (from)
+		:"memory");
+	return n;
+}
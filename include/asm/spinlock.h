@@ -0,0 +1,67 @@
+#ifndef _ASM_SPINLOCK_H
+#define _ASM_SPINLOCK_H
+
+#include <asm/system.h>
+
+/*
+ * 自旋锁
+ * 单处理器(UP)下所有操作都为空，互斥仍然依靠cli/sti
+ * 多处理器(SMP)下使用lock btsl实现，等待时使用pause降低总线压力
+ *
+ * 自旋锁只能保护不会睡眠的临界区，持有自旋锁时不能调用schedule
+ */
+typedef struct {
+	volatile unsigned long lock;
+} spinlock_t;
+
+#define SPIN_LOCK_UNLOCKED	{ 0 }
+
+#ifdef CONFIG_SMP
+
+#define spin_lock_init(l)	((l)->lock = 0)
+
+static inline void spin_lock(spinlock_t * l)
+{
+	__asm__ __volatile__(
+		"1:\tlock ; btsl $0,%0\n\t"
+		"jnc 3f\n"
+		"2:\trep ; nop\n\t"		/* pause */
+		"testl $1,%0\n\t"
+		"jne 2b\n\t"
+		"jmp 1b\n"
+		"3:"
+		:"+m" (l->lock)::"memory");
+}
+
+static inline void spin_unlock(spinlock_t * l)
+{
+	__asm__ __volatile__("lock ; btrl $0,%0":"+m" (l->lock)::"memory");
+}
+
+static inline int spin_trylock(spinlock_t * l)
+{
+	unsigned long old = 1;
+
+	__asm__ __volatile__("xchgl %0,%1"
+		:"+r" (old),"+m" (l->lock)::"memory");
+	return !old;
+}
+
+#else
+
+#define spin_lock_init(l)	do { } while (0)
+#define spin_lock(l)		do { } while (0)
+#define spin_unlock(l)		do { } while (0)
+#define spin_trylock(l)		(1)
+
+#endif
+
+/*
+ * 同时关本CPU中断并获取自旋锁，用于可能在中断中访问的数据
+ */
+#define spin_lock_irqsave(l,flags) \
+	do { local_irq_disable(flags); spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l,flags) \
+	do { spin_unlock(l); local_irq_restore(flags); } while (0)
+
+#endif
@@ -49,10 +49,9 @@ void buffer_init(long buffer_end);
 #define SUPER_MAGIC 0x137F
 
 #define NR_OPEN 	20
-#define NR_INODE 	32
+#define NR_INODE 	1024
 #define NR_FILE 	64
 #define NR_SUPER 	8
-#define NR_HASH 	307
 #define NR_BUFFERS 	nr_buffers
 #define BLOCK_SIZE 	1024
 #define BLOCK_SIZE_BITS 10
@@ -99,6 +98,9 @@ struct buffer_head {
 	struct buffer_head * b_next;
 	struct buffer_head * b_prev_free;
 	struct buffer_head * b_next_free;
+	unsigned char b_list;			/* 所在的链表，干净或者脏 */
+	unsigned long b_flushtime;		/* 脏缓冲区应该写回的时间 */
+	struct buffer_head * b_reqnext;	/* 同一个请求中的下一块 */
 };
 
 /*
@@ -138,6 +140,12 @@ struct m_inode {
 	unsigned char i_mount;
 	unsigned char i_seek;
 	unsigned char i_update;
+	unsigned short i_prealloc_block;	/* 预分配窗口的第一块，见bitmap.c */
+	unsigned short i_prealloc_count;
+	/* 缓存的链表，get_empty_inode时不清除 */
+	struct m_inode * i_next;			/* 所有的i节点 */
+	struct m_inode * i_hash_next, * i_hash_prev;
+	struct m_inode * i_lru_next, * i_lru_prev;	/* 没有使用的i节点 */
 };
 
 struct file {
@@ -146,6 +154,10 @@ struct file {
 	unsigned short f_count;
 	struct m_inode * f_inode;
 	off_t f_pos;
+	/* 预读，见file_dev.c */
+	off_t f_ra_next;		/* 顺序读时下一次读的位置 */
+	unsigned long f_ra_end;		/* 已经预读到的块 */
+	unsigned long f_ra_size;	/* 预读窗口的块数，0表示不预读 */
 };
 
 /*
@@ -171,6 +183,8 @@ struct super_block {
 	unsigned char s_lock;
 	unsigned char s_rd_only;
 	unsigned char s_dirt;
+	unsigned long s_free_zones;	/* 空闲数据块数，read_super时统计，分配释放时维护 */
+	unsigned long s_free_inodes;	/* 空闲i节点数 */
 };
 
 /*
@@ -195,7 +209,6 @@ struct dir_entry {
 	char name[NAME_LEN];
 };
 
-extern struct m_inode inode_table[NR_INODE];
 extern struct file file_table[NR_FILE];
 extern struct super_block super_block[NR_SUPER];
 extern struct buffer_head * start_buffer;
@@ -219,20 +232,66 @@ extern struct m_inode * iget(int dev,int nr);
 extern struct m_inode * get_empty_inode(void);
 extern struct m_inode * get_pipe_inode(void);
 extern struct buffer_head * get_hash_table(int dev, int block);
+extern void buffer_hash_show(void);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
+extern int blk_plugged;
+extern void blk_unplug(void);
+extern void blk_show(void);
 extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
-extern int new_block(int dev);
+extern int new_block(int dev, int goal);
+extern int new_file_block(struct m_inode * inode, int goal);
+extern void discard_prealloc(struct m_inode * inode);
+extern void count_free(struct super_block * sb);
 extern void free_block(int dev, int block);
 extern struct m_inode * new_inode(int dev);
 extern void free_inode(struct m_inode * inode);
+extern void hash_new_inode(struct m_inode * inode);
+extern void clear_inode(struct m_inode * inode);
+extern int fs_may_umount(int dev);
 extern int sync_dev(int dev);
 extern struct super_block * get_super(int dev);
 extern int ROOT_DEV;
 
 extern void mount_root(void);
 
+/*
+ * 目录项缓存，name在内核空间
+ */
+extern unsigned long dcache_gen;
+extern void dcache_init(void);
+extern int dcache_lookup(int dev, int dir, const char * name, int len);
+extern void dcache_add(int dev, int dir, const char * name, int len, int ino);
+extern void dcache_remove(int dev, int dir, const char * name, int len);
+extern void dcache_purge(int dev, int dir);
+extern void dcache_show(void);
+extern int dindex_find(struct m_inode * dir, const char * name, int namelen,
+	struct buffer_head ** res_bh, struct dir_entry ** res_dir);
+extern int dindex_slot(struct m_inode * dir, int * block);
+extern void dindex_insert(struct m_inode * dir, struct buffer_head * bh,
+	struct dir_entry * de);
+extern void dindex_remove(struct m_inode * dir, struct buffer_head * bh,
+	struct dir_entry * de);
+extern void dindex_purge(int dev, int ino);
+extern void dindex_show(void);
+
+/*
+ * select/poll，对象没有就绪时通过select_wait把进程登记到对象的等待队列上
+ * wait为NULL表示只检查状态不登记
+ */
+#define SEL_IN		1
+#define SEL_OUT		2
+#define SEL_EX		4
+
+struct select_table {
+	int nr;			/* 当前进程登记的个数 */
+	int overflow;		/* 登记表满了，只能定时轮询 */
+};
+
+extern void select_wait(struct task_struct ** wait_address, struct select_table * wait);
+extern int pipe_select(struct m_inode * inode, int flag, struct select_table * wait);
+
 #endif
@@ -40,6 +40,47 @@
 #define WIN_SEEK 		0x70
 #define WIN_DIAGNOSE		0x90
 #define WIN_SPECIFY		0x91
+#define WIN_READ_EXT		0x24	/* LBA48 */
+#define WIN_WRITE_EXT		0x34
+#define WIN_MULTREAD		0xC4	/* 每次中断传送多个扇区 */
+#define WIN_MULTWRITE		0xC5
+#define WIN_SETMULT		0xC6	/* 设置每次中断传送的扇区数 */
+#define WIN_MULTREAD_EXT	0x29
+#define WIN_MULTWRITE_EXT	0x39
+#define WIN_IDENTIFY		0xEC
+#define WIN_READDMA		0xC8
+#define WIN_WRITEDMA		0xCA
+#define WIN_READDMA_EXT		0x25
+#define WIN_WRITEDMA_EXT	0x35
+
+/*
+ * PCI IDE控制器的bus master寄存器，相对于BAR4
+ */
+#define BM_COMMAND		0
+#define BM_STATUS		2
+#define BM_PRD			4	/* PRD表的物理地址 */
+
+#define BM_CMD_START		0x01
+#define BM_CMD_READ		0x08	/* 设备到内存 */
+
+#define BM_STAT_ACTIVE		0x01
+#define BM_STAT_ERR		0x02	/* 写1清除 */
+#define BM_STAT_INTR		0x04	/* 写1清除 */
+
+/* Bits of HD_CMD */
+#define CTL_NIEN		0x02	/* 不产生中断 */
+
+/* Bits of HD_CURRENT */
+#define LBA_FLAG		0x40
+
+/*
+ * IDENTIFY返回的256个字中用到的部分
+ */
+#define ID_MAX_MULT		47	/* 低字节为最多的扇区数 */
+#define ID_CAPABILITY		49	/* bit8为支持DMA，bit9为支持LBA */
+#define ID_LBA_SECTS		60	/* 60-61, LBA28的扇区数 */
+#define ID_CMD_SET2		83	/* bit10为支持LBA48 */
+#define ID_LBA48_SECTS		100	/* 100-103, LBA48的扇区数 */
 
 /* Bits for HD_ERROR */
 #define MARK_ERR	0x01	/* Bad address mark ? */
@@ -26,6 +26,12 @@ extern desc_table idt,gdt;
 #define GDT_DATA 	2
 #define GDT_TMP 	3
 
+/*
+ * SYSENTER/SYSEXIT要求连续的四个描述符：内核代码段，内核数据段，
+ * 用户代码段，用户数据段，基地址都为0，放在GDT的最后
+ */
+#define GDT_SYSENTER	252
+
 /*
  * 每个进程使用了第三个局部描述符
  * 第一个是NULL
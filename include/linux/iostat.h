@@ -0,0 +1,45 @@
+#ifndef _LINUX_IOSTAT_H
+#define _LINUX_IOSTAT_H
+
+/*
+ * 块设备I/O统计，字段和Linux的/proc/diskstats对应，
+ * 用户程序两次读取的差值除以间隔得到iostat的r/s, w/s, await, %util等
+ *
+ * 每个主设备一项总计(minor为-1)，每个用到的次设备一项
+ * 时间的单位为微秒
+ * queue_time 请求进入队列到驱动程序开始处理的时间
+ * service_time 驱动程序开始处理到完成的时间
+ * io_time 队列中有请求的时间
+ * weighted_time 队列中的请求数对时间的积分
+ */
+#define IOSTAT_GET_DISK		1	/* 复制disk_stat到buf，返回项数 */
+#define IOSTAT_GET_CACHE	2	/* 复制cache_stat到buf */
+#define IOSTAT_RESET		3	/* 清零所有统计 */
+
+struct disk_stat {
+	short major, minor;
+	unsigned long ios[2];		/* 完成的请求数，[0]为读，[1]为写 */
+	unsigned long merges[2];	/* 合并到已有请求的块数 */
+	unsigned long sectors[2];
+	unsigned long long queue_time[2];
+	unsigned long long service_time[2];
+	unsigned long in_flight;	/* 当前队列中的请求数 */
+	unsigned long long io_time;
+	unsigned long long weighted_time;
+	unsigned long stamp;		/* 上次更新io_time的时间 */
+};
+
+/*
+ * getblk在缓存中找到和没有找到的次数，
+ * bread时缓冲区已经有效和需要读盘的次数
+ */
+struct cache_stat {
+	unsigned long getblk_hits;
+	unsigned long getblk_misses;
+	unsigned long bread_hits;
+	unsigned long bread_misses;
+};
+
+extern int iostat(int cmd, char * buf, int size);
+
+#endif
@@ -3,6 +3,7 @@
 
 extern unsigned long get_free_page(void);
 extern unsigned long put_page(unsigned long page,unsigned long address);
+extern void put_time_page(void);
 extern unsigned long put_dirty_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
 #ifndef PAGE_SIZE
@@ -0,0 +1,56 @@
+#ifndef _PCI_H
+#define _PCI_H
+
+/*
+ * PCI总线，使用配置机制1访问配置空间
+ */
+#define PCI_CONFIG_ADDR		0xCF8
+#define PCI_CONFIG_DATA		0xCFC
+
+/* 配置空间寄存器 */
+#define PCI_VENDOR_ID		0x00
+#define PCI_DEVICE_ID		0x02
+#define PCI_COMMAND		0x04
+#define  PCI_COMMAND_IO		0x01
+#define  PCI_COMMAND_MEMORY	0x02
+#define  PCI_COMMAND_MASTER	0x04
+#define PCI_CLASS_REVISION	0x08	/* 高24位为类别，子类别，编程接口 */
+#define PCI_HEADER_TYPE		0x0E	/* bit7为多功能设备 */
+#define PCI_BASE_ADDRESS_0	0x10
+#define PCI_BASE_ADDRESS_4	0x20
+#define PCI_SECONDARY_BUS	0x19	/* PCI桥 */
+#define PCI_INTERRUPT_LINE	0x3C
+
+#define PCI_BASE_ADDRESS_IO_MASK	(~0x03UL)
+
+#define PCI_CLASS_STORAGE_IDE	0x0101
+#define PCI_CLASS_BRIDGE_PCI	0x0604
+
+#define PCI_DEVFN(slot,func)	((((slot) & 0x1f) << 3) | ((func) & 0x07))
+#define PCI_SLOT(devfn)		(((devfn) >> 3) & 0x1f)
+#define PCI_FUNC(devfn)		((devfn) & 0x07)
+
+#define NR_PCI_DEV	32
+
+/*
+ * class为类别(16位)和编程接口(8位)
+ */
+struct pci_dev {
+	unsigned char bus, devfn;
+	unsigned short vendor, device;
+	unsigned long class;
+	unsigned char irq;
+};
+
+extern struct pci_dev pci_devices[NR_PCI_DEV];
+extern int nr_pci_devices;
+
+extern unsigned long pci_read_config_dword(struct pci_dev * dev, int where);
+extern unsigned short pci_read_config_word(struct pci_dev * dev, int where);
+extern unsigned char pci_read_config_byte(struct pci_dev * dev, int where);
+extern void pci_write_config_dword(struct pci_dev * dev, int where, unsigned long val);
+extern void pci_write_config_word(struct pci_dev * dev, int where, unsigned short val);
+extern struct pci_dev * pci_find_class(unsigned int class, struct pci_dev * from);
+extern void pci_init(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _LINUX_RBTREE_H
+#define _LINUX_RBTREE_H
+
+/*
+ * 红黑树
+ *
+ * 节点嵌入到使用者的结构中，通过rb_entry取得外层结构，
+ * 查找和插入位置由使用者自己比较，找到位置后调用rb_link_node挂上，
+ * 再调用rb_insert_color重新平衡
+ */
+struct rb_node {
+	unsigned long rb_color;
+#define	RB_RED		0
+#define	RB_BLACK	1
+	struct rb_node * rb_parent;
+	struct rb_node * rb_left;
+	struct rb_node * rb_right;
+};
+
+struct rb_root {
+	struct rb_node * rb_node;
+};
+
+#define RB_ROOT	{ 0 }
+
+#define rb_entry(ptr, type, member) \
+	((type *)((char *)(ptr)-(unsigned long)(&((type *)0)->member)))
+
+extern void rb_insert_color(struct rb_node * node, struct rb_root * root);
+extern void rb_erase(struct rb_node * node, struct rb_root * root);
+extern struct rb_node * rb_first(struct rb_root * root);
+extern struct rb_node * rb_next(struct rb_node * node);
+
+static inline void rb_link_node(struct rb_node * node, struct rb_node * parent,
+				struct rb_node ** link)
+{
+	node->rb_parent = parent;
+	node->rb_color = RB_RED;
+	node->rb_left = node->rb_right = 0;
+	*link = node;
+}
+
+#endif
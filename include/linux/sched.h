@@ -18,7 +18,10 @@
 #include <linux/head.h>
 #include <linux/fs.h>
 #include <linux/mm.h>
+#include <linux/smp.h>
+#include <linux/rbtree.h>
 #include <signal.h>
+#include <sched.h>
 
 #if (NR_OPEN > 32)
 #error "Currently the close-on-exec-flags are in one word, max 32 files/proc"
@@ -35,6 +38,11 @@
 #define TASK_ZOMBIE				3
 #define TASK_STOPPED			4
 
+/*
+ * SCHED_RR实时进程的时间片，100ms
+ */
+#define RR_TIMESLICE			(HZ/10)
+
 #ifndef NULL
 #define NULL ((void *) 0)
 #endif
@@ -123,6 +131,49 @@ struct task_struct {
 	struct desc_struct ldt[3];
 /* tss for this task */
 	struct tss_struct tss;
+/*
+ * policy 	调度策略SCHED_OTHER/SCHED_FIFO/SCHED_RR
+ * rt_priority 	实时优先级1~99，普通进程为0
+ * rt_seq 	同一实时优先级内的排队序号，越小越先运行
+ */
+	long policy;
+	long rt_priority;
+	unsigned long rt_seq;
+/* timeout 	nanosleep的到期时间(jiffies)，0表示没有 */
+	long timeout;
+/*
+ * trace 	进程的系统调用写入跟踪缓冲区，fork时不继承
+ * sys_nr 	正在执行的系统调用号
+ * sys_start 	系统调用开始的时间
+ */
+	long trace;
+	long sys_nr;
+	unsigned long sys_start;
+#ifdef CONFIG_FAIR_SCHED
+/*
+ * run_node 	可运行进程红黑树中的节点，按vruntime排序
+ * vruntime 	按nice加权后的虚拟运行时间
+ * nice 	-20~19，决定进程的权重
+ * on_rq 	进程计入了运行队列，包括正在运行的进程
+ * in_tree 	进程在红黑树中
+ */
+	struct rb_node run_node;
+	unsigned long vruntime;
+	long nice;
+	int on_rq;
+	int in_tree;
+#endif
+#ifdef CONFIG_SMP
+/*
+ * processor 	进程所属的CPU运行队列
+ * has_cpu 	进程正在某个CPU上运行，其他CPU不能选中它
+ * lock_depth 	进程持有的大内核锁的递归深度
+ * 放在最后是为了不影响INIT_TASK和汇编中的偏移
+ */
+	int processor;
+	int has_cpu;
+	int lock_depth;
+#endif
 };
 
 /*
@@ -154,9 +205,24 @@ struct task_struct {
 
 extern struct task_struct *task[NR_TASKS];
 extern struct task_struct *last_task_used_math;
+#ifdef CONFIG_SMP
+#define current (current_set[smp_processor_id()])
+#else
 extern struct task_struct *current;
+#endif
 extern long volatile jiffies;
 extern long startup_time;
+extern int nr_rt_tasks;
+extern struct task_struct * find_task_by_pid(int pid);
+extern void systrace_untrace(struct task_struct * p);
+
+#ifdef CONFIG_FAIR_SCHED
+extern void fair_check_task(struct task_struct * p);
+extern void fair_put_prev(struct task_struct * prev);
+extern struct task_struct * fair_pick_next(void);
+extern int fair_tick(struct task_struct * curr);
+extern void fair_set_nice(struct task_struct * p, long nice);
+#endif
 
 #define CURRENT_TIME (startup_time+jiffies/HZ)
 
@@ -164,6 +230,10 @@ extern void add_timer(long jiffies, void (*fn)(void));
 extern void sleep_on(struct task_struct ** p);
 extern void interruptible_sleep_on(struct task_struct ** p);
 extern void wake_up(struct task_struct ** p);
+extern int nr_select_wait;
+extern void wake_up_select(struct task_struct ** p);
+extern void vsyscall_init(void);
+extern void sysenter_setup(struct tss_struct * tss);
 
 /*
  * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
@@ -171,6 +241,10 @@ extern void wake_up(struct task_struct ** p);
  */
 #define FIRST_TSS_ENTRY 4
 #define FIRST_LDT_ENTRY (FIRST_TSS_ENTRY+1)
+/*
+ * SMP时每个CPU一个TSS，放在所有进程的TSS和LDT之后
+ */
+#define FIRST_CPU_TSS_ENTRY (FIRST_TSS_ENTRY+2*NR_TASKS)
 /* _TSS(n) 表示任务n的TSS段描述子，其地址指向一个在GDT中的TSS段，每个任务都有自己TSS段
  * _LDT(n) 表示任务n的LDT段描述子，其地址指向一个在GDT中的LDT段，每个任务都有自己LDT段
  * 如n为0
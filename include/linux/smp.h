@@ -0,0 +1,96 @@
+#ifndef _SMP_H
+#define _SMP_H
+
+/*
+ * 对称多处理(SMP)支持
+ *
+ * 使用make SMP=1编译，未定义CONFIG_SMP时以下接口全部退化为空操作，
+ * 单处理器内核的行为和原来完全一样
+ *
+ * SMP内核的基本模型：
+ * 1. 所有进入内核的路径（系统调用，时钟，缺页，设备中断）都要获取
+ *    大内核锁(kernel_flag)，该锁可以在同一个CPU上递归获取，
+ *    因此原来依靠cli/sti互斥的代码在多处理器上仍然是正确的
+ * 2. 每个CPU有自己的current，TSS和idle进程，进程通过processor字段
+ *    属于某一个CPU的运行队列，空闲的CPU会从最忙的CPU上迁移进程
+ * 3. 缓冲区，inode表和mem_map另外使用自旋锁保护，为以后缩小
+ *    大内核锁的范围做准备
+ */
+#define NR_CPUS		8
+#define NO_PROC_ID	0xFF
+
+#ifdef CONFIG_SMP
+
+#ifdef CONFIG_SWITCH_TSS
+#error "SMP only supports task switch by kernel stack"
+#endif
+
+#include <asm/apic.h>
+#include <asm/spinlock.h>
+
+struct task_struct;
+struct tss_struct;
+
+/*
+ * 每个CPU的数据
+ * apic_id 	本CPU的Local APIC ID
+ * online 	CPU已经启动完成
+ * idle 	本CPU的idle进程，BSP的idle进程就是task[0]
+ * tss 		本CPU使用的TSS，内核栈切换时只更新其中的esp0
+ * nr_running 	运行队列中可运行进程的个数，由schedule统计
+ */
+struct cpuinfo {
+	int apic_id;
+	volatile int online;
+	struct task_struct * idle;
+	struct tss_struct * tss;
+	long nr_running;
+	unsigned long nr_switches;
+};
+
+extern struct cpuinfo cpu_data[NR_CPUS];
+extern struct task_struct * current_set[NR_CPUS];
+extern unsigned char apic_to_cpu[256];
+extern int smp_num_cpus;
+extern volatile unsigned long smp_invalidate_needed;
+
+/*
+ * 每次使用current都要取CPU号，读Local APIC的ID是不可缓存的MMIO访问
+ * SMP只用内核栈切换，每个CPU的TR在启动后不再改变，用str取TSS选择子换算：
+ * BSP是_TSS(0)(ltr之前为0)，AP是FIRST_CPU_TSS_ENTRY+cpu
+ * 进程可能在schedule之后换到其他CPU上，所以asm是volatile的
+ */
+static inline int __smp_processor_id(int first)
+{
+	unsigned short sel;
+
+	__asm__ __volatile__("str %0":"=r" (sel));
+	sel >>= 3;
+	return sel < first ? 0 : sel - first;
+}
+
+#define smp_processor_id()	__smp_processor_id(FIRST_CPU_TSS_ENTRY)
+
+extern void smp_init(void);
+extern void smp_boot_cpus(void);
+extern void smp_commence(void);
+extern void smp_flush_tlb(void);
+extern int smp_pick_cpu(void);
+extern void lock_kernel(void);
+extern void unlock_kernel(void);
+extern void release_kernel_lock(void);
+
+#else
+
+#define smp_processor_id()	0
+#define smp_num_cpus		1
+
+#define smp_init()		do { } while (0)
+#define smp_boot_cpus()		do { } while (0)
+#define smp_commence()		do { } while (0)
+#define lock_kernel()		do { } while (0)
+#define unlock_kernel()		do { } while (0)
+
+#endif
+
+#endif
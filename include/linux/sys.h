@@ -85,6 +85,20 @@ extern int sys_symlink();
 extern int sys_lstat();
 extern int sys_readlink();
 extern int sys_uselib();
+extern int sys_sched_setscheduler();
+extern int sys_sched_getscheduler();
+extern int sys_clock_gettime();
+extern int sys_nanosleep();
+extern int sys_poll();
+extern int sys_readv();
+extern int sys_writev();
+extern int sys_pread();
+extern int sys_pwrite();
+extern int sys_sendfile();
+extern int sys_systrace();
+extern int sys_bdflush();
+extern int sys_iostat();
+extern int sys_statfs();
 
 
 fn_ptr sys_call_table[] = { sys_setup, sys_exit, sys_fork, sys_read,
@@ -102,5 +116,8 @@ sys_getpgrp, sys_setsid, sys_sigaction, sys_sgetmask, sys_ssetmask,
 sys_setreuid,sys_setregid, sys_sigsuspend, sys_sigpending, sys_sethostname,
 sys_setrlimit, sys_getrlimit, sys_getrusage, sys_gettimeofday, 
 sys_settimeofday, sys_getgroups, sys_setgroups, sys_select, sys_symlink,
-sys_lstat, sys_readlink, sys_uselib };
+sys_lstat, sys_readlink, sys_uselib, sys_sched_setscheduler,
+sys_sched_getscheduler, sys_clock_gettime, sys_nanosleep, sys_poll,
+sys_readv, sys_writev, sys_pread, sys_pwrite, sys_sendfile,
+sys_systrace, sys_bdflush, sys_iostat, sys_statfs };
 
@@ -0,0 +1,51 @@
+#ifndef _LINUX_SYSTRACE_H
+#define _LINUX_SYSTRACE_H
+
+/*
+ * 系统调用统计和跟踪
+ *
+ * 统计：每个系统调用的次数，总耗时和耗时的直方图，
+ * 可以只统计一个进程(pid)，pid为0时统计所有进程
+ * 跟踪：标记了的进程每次进入和退出系统调用时写一条记录到环形缓冲区
+ *
+ * 耗时的单位：CPU支持TSC时为时钟周期，否则为滴答
+ * 直方图第i项为耗时在[2^i, 2^(i+1))之间的次数，第0项包括0
+ *
+ * 都关闭时system_call中只多一次比较和不跳转的分支
+ */
+#define SYSTRACE_NR		128	/* 统计表的项数，要大于系统调用的个数 */
+#define SYSTRACE_HIST		32
+#define SYSTRACE_RING		256	/* 环形缓冲区的记录数 */
+
+/* sys_systrace的命令 */
+#define SYSTRACE_STATS_ON	1	/* arg为pid，0表示所有进程 */
+#define SYSTRACE_STATS_OFF	2
+#define SYSTRACE_TRACE_ON	3	/* arg为pid */
+#define SYSTRACE_TRACE_OFF	4
+#define SYSTRACE_GET_STATS	5	/* 复制统计表到buf，arg为buf的字节数 */
+#define SYSTRACE_GET_TRACE	6	/* 取出记录到buf，arg为最多的记录数 */
+#define SYSTRACE_RESET		7	/* 清空统计表和环形缓冲区 */
+
+struct systrace_stat {
+	unsigned long count;
+	unsigned long long time;
+	unsigned long hist[SYSTRACE_HIST];
+};
+
+#define SYSTRACE_ENTER		0
+#define SYSTRACE_EXIT		1
+
+/*
+ * 进入时val为第一个参数，退出时val为返回值
+ */
+struct systrace_record {
+	long pid;
+	unsigned short nr;
+	unsigned short type;
+	long val;
+	unsigned long time;
+};
+
+extern int systrace(int cmd, long arg, char * buf);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _LINUX_TIME_H
+#define _LINUX_TIME_H
+
+#include <time.h>
+
+/*
+ * PIT的输入时钟为1193180Hz，LATCH为每个滴答的计数值
+ */
+#define CLOCK_TICK_RATE	1193180
+#define LATCH		(CLOCK_TICK_RATE/HZ)
+
+#define NSEC_PER_SEC	1000000000
+#define NSEC_PER_TICK	(NSEC_PER_SEC/HZ)
+
+extern long startup_nsec;
+extern long next_timeout;
+extern int tsc_present;
+extern unsigned long tsc_khz;
+
+extern void pit_mdelay(int ms);
+extern void clocksource_init(void);
+extern void time_tick(void);
+extern void do_monotonic(struct timespec * ts);
+extern void do_realtime(struct timespec * ts);
+extern void update_vtime(void);
+extern unsigned long time_page[];
+
+#endif
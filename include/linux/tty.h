@@ -74,4 +74,7 @@ void con_write(struct tty_struct * tty);
 
 void copy_to_cooked(struct tty_struct * tty);
 
+struct select_table;
+int tty_select(unsigned c, int flag, struct select_table * wait);
+
 #endif
@@ -0,0 +1,34 @@
+#ifndef _LINUX_VTIME_H
+#define _LINUX_VTIME_H
+
+/*
+ * 共享时间页
+ *
+ * 内核在每次时钟中断时更新这个页，exec时只读映射到每个进程的VTIME_ADDR处，
+ * 用户程序不用进入内核就可以读到时间，见lib/clock_gettime.c
+ *
+ * seq为奇数表示内核正在更新，读者需要等到seq为偶数，
+ * 并且读完后seq没有变化，读到的数据才是一致的
+ */
+#define VTIME_ADDR	0xBF000000
+
+/*
+ * 系统调用入口页，紧接着时间页映射，
+ * 支持SYSENTER的CPU上使用sysenter进入内核，否则使用int 0x80
+ */
+#define VSYSCALL_ADDR	(VTIME_ADDR+0x1000)
+
+struct vtime_data {
+	volatile unsigned long seq;
+	long jiffies;			/* 最近一次时钟中断时的jiffies */
+	long hz;
+	long tick_nsec;			/* 每个滴答的纳秒数 */
+	long startup_time;		/* 墙上时间 = 启动时间 + 单调时间 */
+	long startup_nsec;
+	unsigned long tsc_present;	/* 为0时用户态不能计算滴答内的偏移 */
+	unsigned long tsc_at_tick;	/* 最近一次时钟中断时的TSC */
+	unsigned long tsc_mult;		/* ns = (delta * tsc_mult) >> tsc_shift */
+	unsigned long tsc_shift;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _POSIX_SCHED_H
+#define _POSIX_SCHED_H
+
+#include <sys/types.h>
+
+/*
+ * 调度策略
+ * SCHED_OTHER 	普通进程，使用counter/priority调度
+ * SCHED_FIFO 	实时进程，没有时间片，一直运行到睡眠或者被更高优先级的实时进程抢占
+ * SCHED_RR 	实时进程，时间片用完后排到同优先级的最后
+ */
+#define SCHED_OTHER	0
+#define SCHED_FIFO	1
+#define SCHED_RR	2
+
+/*
+ * 实时进程的优先级范围，普通进程为0
+ */
+#define SCHED_RT_PRIO_MIN	1
+#define SCHED_RT_PRIO_MAX	99
+
+struct sched_param {
+	int sched_priority;
+};
+
+extern int sched_setscheduler(pid_t pid, int policy, const struct sched_param * param);
+extern int sched_getscheduler(pid_t pid);
+
+#endif
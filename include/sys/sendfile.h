@@ -0,0 +1,8 @@
+#ifndef _SYS_SENDFILE_H
+#define _SYS_SENDFILE_H
+
+#include <sys/types.h>
+
+extern int sendfile(int out_fd, int in_fd, off_t * offset, size_t count);
+
+#endif
@@ -28,6 +28,7 @@ struct timezone {
 #define FD_CLR(fd,fdsetp)	(*(fdsetp) &= ~(1 << (fd)))
 #define FD_ISSET(fd,fdsetp)	((*(fdsetp) >> fd) & 1)
 #define FD_ZERO(fdsetp)		(*(fdsetp) = 0)
+#define FD_SETSIZE		(8*sizeof(fd_set))
 
 
 /*
@@ -54,5 +55,7 @@ struct tms {
 };
 
 extern time_t times(struct tms * tp);
+extern int select(int n, fd_set * readfds, fd_set * writefds,
+	fd_set * exceptfds, struct timeval * timeout);
 
 #endif
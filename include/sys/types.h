@@ -33,6 +33,8 @@ typedef long off_t;
 typedef unsigned char u_char;
 typedef unsigned short ushort;
 
+typedef unsigned long fd_set;
+
 typedef struct { int quot,rem; } div_t;
 typedef struct { long quot,rem; } ldiv_t;
 
@@ -0,0 +1,24 @@
+#ifndef _SYS_VFS_H
+#define _SYS_VFS_H
+
+/*
+ * 文件系统的容量信息，块数以f_bsize为单位
+ * 空闲数来自超级块中维护的计数，不需要扫描位图
+ */
+#define MINIX_SUPER_MAGIC	0x137F
+
+struct statfs {
+	long f_type;		/* 文件系统类型，即超级块中的s_magic */
+	long f_bsize;		/* 逻辑块大小 */
+	long f_blocks;		/* 数据区的总块数 */
+	long f_bfree;		/* 空闲块数 */
+	long f_bavail;		/* 普通用户可用的块数 */
+	long f_files;		/* i节点总数 */
+	long f_ffree;		/* 空闲i节点数 */
+	long f_fsid;		/* 设备号 */
+	long f_namelen;		/* 文件名的最大长度 */
+};
+
+extern int statfs(const char * path, struct statfs * buf);
+
+#endif
@@ -147,12 +147,42 @@
 #define __NR_lstat 84
 #define __NR_readlink 85
 #define __NR_uselib 86
+#define __NR_sched_setscheduler 87
+#define __NR_sched_getscheduler 88
+#define __NR_clock_gettime 89
+#define __NR_nanosleep 90
+#define __NR_poll 91
+#define __NR_readv 92
+#define __NR_writev 93
+#define __NR_pread 94
+#define __NR_pwrite 95
+#define __NR_sendfile 96
+#define __NR_systrace 97
+#define __NR_bdflush 98
+#define __NR_iostat 99
+#define __NR_statfs 100
+
+/*
+ * __vsyscall不为0时调用系统调用入口页（CPU支持时使用sysenter进入内核），
+ * 为0时使用int 0x80。exec之后的程序调用use_vsyscall()打开，
+ * 进程0和1在exec之前没有映射入口页，只能使用int 0x80
+ */
+extern long __vsyscall;
+extern void use_vsyscall(void);
+
+#define __SYSCALL_INSN \
+	"cmpl $0,__vsyscall\n\t" \
+	"je 1f\n\t" \
+	"call *__vsyscall\n\t" \
+	"jmp 2f\n" \
+	"1:\tint $0x80\n" \
+	"2:"
 
 #define _syscall0(type,name) \
   type name(void) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_INSN \
 	: "=a" (__res) \
 	: "0" (__NR_##name)); \
 if (__res >= 0) \
@@ -165,7 +195,7 @@ return -1; \
 type name(atype a) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_INSN \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a))); \
 if (__res >= 0) \
@@ -178,7 +208,7 @@ return -1; \
 type name(atype a,btype b) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_INSN \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b))); \
 if (__res >= 0) \
@@ -191,7 +221,7 @@ return -1; \
 type name(atype a,btype b,ctype c) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_INSN \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c))); \
 if (__res>=0) \
@@ -243,6 +273,8 @@ int nice(int val);
 //static int pause(void);
 int pipe(int * fildes);
 int read(int fildes, char * buf, off_t count);
+int pread(int fildes, char * buf, off_t count, off_t offset);
+int pwrite(int fildes, const char * buf, off_t count, off_t offset);
 int setpgrp(void);
 int setpgid(pid_t pid,pid_t pgid);
 int setuid(uid_t uid);
@@ -265,6 +297,7 @@ int utime(const char * filename, struct utimbuf * times);
 //pid_t wait(int * wait_stat);
 //int write(int fildes, const char * buf, off_t count);
 int dup2(int oldfd, int newfd);
+//int bdflush(int func, long data);
 int getppid(void);
 pid_t getpgrp(void);
 //pid_t setsid(void);
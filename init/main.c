@@ -46,6 +46,7 @@ static _syscall3(int,open,const char *,file,int,flag,int,mode)
 static _syscall1(int,close,int,fd)
 static _syscall3(pid_t,waitpid,pid_t,pid,int *,wait_stat,int,options)
 static _syscall0(int,getpid)
+static _syscall2(int,bdflush,int,func,long,data)
 
 static pid_t wait(int * wait_stat)
 {
@@ -57,6 +58,7 @@ void init(void);
 #include <linux/tty.h>
 #include <linux/sched.h>
 #include <linux/head.h>
+#include <linux/time.h>
 #include <asm/system.h>
 #include <asm/io.h>
 
@@ -75,6 +77,7 @@ extern void init(void);
 extern void blk_dev_init(void);
 extern void chr_dev_init(void);
 extern void hd_init(void);
+extern void pci_init(void);
 extern void floppy_init(void);
 extern void mem_init(long start, long end);
 extern long get_available_pages(void);
@@ -141,6 +144,10 @@ void start_kernel(int __a, int __b, int __c)
 	 * Interrupts are still disabled. Do necessary setups, then
 	 * enable them
 	 */
+	/*
+	 * SMP时首先映射Local APIC，此后current才可以使用
+	 */
+	smp_init();
 	/*
 	 * ORIG_ROOT_DEV是在bootsect模块中root_dev的地址的值
 	 * 也就是根文件系统的设备号
@@ -203,11 +210,17 @@ void start_kernel(int __a, int __b, int __c)
 	printk("ramdisk size is %dMB\n", RAMDISK_SIZE/1024);
 #endif
 	time_init();
+	clocksource_init();
 	sched_init();
+	vsyscall_init();
+	smp_boot_cpus();
 	buffer_init(buffer_memory_end);
+	dcache_init();
+	pci_init();
 	hd_init();
 	floppy_init();
 	show_mem();
+	smp_commence();
 
 	/*
 	 * sti允许中断
@@ -320,6 +333,13 @@ void init(void)
 	int pid, i;
 
 	setup((void *) &drive_info);
+	/*
+	 * 回写进程，一直在bdflush系统调用中运行
+	 */
+	if (!fork()) {
+		bdflush(0, 0);
+		_exit(0);
+	}
 	(void) open(ttydev, O_RDWR, 0);
 	(void) dup(0);
 	(void) dup(0);
@@ -36,8 +36,16 @@ no_error_code:
 	mov %dx,%ds
 	mov %dx,%es
 	mov %dx,%fs
+.ifdef CONFIG_SMP
+	pushl %eax
+	call lock_kernel
+	popl %eax
+.endif
 	call *%eax
 	addl $8,%esp
+.ifdef CONFIG_SMP
+	call unlock_kernel
+.endif
 	pop %fs
 	pop %es
 	pop %ds
@@ -114,8 +122,14 @@ error_code:
 	mov %ax,%ds
 	mov %ax,%es
 	mov %ax,%fs
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	call *%ebx
 	addl $8,%esp
+.ifdef CONFIG_SMP
+	call unlock_kernel
+.endif
 	pop %fs
 	pop %es
 	pop %ds
@@ -17,12 +17,21 @@
  */
 #define NR_REQUEST	32
 
+/*
+ * 合并后一个请求最多的扇区数，硬盘一次命令最多256个扇区
+ */
+#define MAX_SECTORS	128
+
 /*
  * Ok, this is an expanded form so that we can use the same
  * request for paging requests when that is implemented. In
  * paging, 'bh' is NULL, and 'waiting' is used to wait for
  * read/write completion.
  */
+/*
+ * 相邻的缓冲块合并到一个请求中，用b_reqnext串起来，bh是第一个还没有完成的，
+ * sector, nr_sectors, buffer描述剩下的部分，驱动程序每完成一块调用end_request(1)
+ */
 struct request {
 	int dev;		/* -1 if no request */
 	int cmd;		/* READ or WRITE */
@@ -32,6 +41,11 @@ struct request {
 	char * buffer;
 	struct task_struct * waiting;
 	struct buffer_head * bh;
+	struct buffer_head * bhtail;
+	unsigned long start_time;	/* 进入队列的时间，jiffies */
+	struct disk_stat * stat;	/* 次设备的统计，见iostat.c */
+	unsigned long queue_us;		/* 进入队列的时间，微秒 */
+	unsigned long issue_us;		/* 交给驱动程序的时间 */
 	struct request * next;
 };
 
@@ -54,11 +68,58 @@ struct request {
 ((s1)->dev < (s2)->dev || ((s1)->dev == (s2)->dev && \
 (s1)->sector < (s2)->sector))))
 
+/*
+ * I/O调度器，决定队列中请求的顺序，队列头是驱动程序正在处理的请求
+ * add_request 队列不为空时把req加入队列
+ * next_request 队列头完成后选择下一个请求放到队列头
+ */
+struct blk_dev_struct;
+
+struct elevator {
+	char * name;
+	void (*add_request)(struct blk_dev_struct * dev, struct request * req);
+	void (*next_request)(struct blk_dev_struct * dev);
+};
+
+extern struct elevator elevator_sort;
+extern struct elevator elevator_deadline;
+
+/*
+ * 默认的调度器，使用make DEADLINE=1编译时为deadline
+ */
+#ifdef CONFIG_IOSCHED_DEADLINE
+#define DEFAULT_ELEVATOR	elevator_deadline
+#else
+#define DEFAULT_ELEVATOR	elevator_sort
+#endif
+
+/*
+ * 请求从进入队列到完成的时间，单位为滴答，按读写分开统计
+ */
+struct blk_latency {
+	unsigned long nr;
+	unsigned long sum;
+	unsigned long max;
+};
+
+/*
+ * plugged表示队列中的请求还没有交给驱动程序，等待后面的请求合并
+ */
 struct blk_dev_struct {
 	void (*request_fn)(void);
 	struct request * current_request;
+	int plugged;
+	struct elevator * elevator;
+	struct blk_latency latency[2];
 };
 
+extern void elv_next_request(struct blk_dev_struct * dev);
+
+extern void blk_account_queue(struct request * req);
+extern void blk_account_merge(struct request * req);
+extern void blk_account_issue(struct request * req);
+extern void blk_account_done(struct request * req);
+
 extern struct blk_dev_struct blk_dev[NR_BLK_DEV];
 extern struct request request[NR_REQUEST];
 extern struct task_struct * wait_for_request;
@@ -118,22 +179,35 @@ static inline void unlock_buffer(struct buffer_head * bh)
 	wake_up(&bh->b_wait);
 }
 
+/*
+ * 成功时完成请求中的第一个缓冲块，还有缓冲块时buffer指向下一块，请求不结束
+ * 失败时请求中所有的缓冲块都失败
+ */
 static inline void end_request(int uptodate)
 {
-	DEVICE_OFF(CURRENT->dev);
-	if (CURRENT->bh) {
-		CURRENT->bh->b_uptodate = uptodate;
-		unlock_buffer(CURRENT->bh);
-	}
-	if (!uptodate) {
-		printk(DEVICE_NAME " I/O error\n\r");
-		printk("dev %04x, block %d\n\r",CURRENT->dev,
-			CURRENT->bh->b_blocknr);
+	struct buffer_head * bh;
+	struct request * req;
+
+	while ((bh = CURRENT->bh)) {
+		CURRENT->bh = bh->b_reqnext;
+		bh->b_reqnext = NULL;
+		bh->b_uptodate = uptodate;
+		unlock_buffer(bh);
+		if (!uptodate) {
+			printk(DEVICE_NAME " I/O error\n\r");
+			printk("dev %04x, block %d\n\r",CURRENT->dev,
+				bh->b_blocknr);
+		} else if (CURRENT->bh) {
+			CURRENT->buffer = CURRENT->bh->b_data;
+			return;
+		}
 	}
+	DEVICE_OFF(CURRENT->dev);
 	wake_up(&CURRENT->waiting);
 	wake_up(&wait_for_request);
-	CURRENT->dev = -1;
-	CURRENT = CURRENT->next;
+	req = CURRENT;
+	elv_next_request(blk_dev + MAJOR_NR);
+	req->dev = -1;
 }
 
 #define INIT_REQUEST \
@@ -0,0 +1,174 @@
+/*
+ *  linux/kernel/blk_drv/elevator.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * I/O调度器
+ *
+ * sort: 原来add_request中的电梯算法，按(设备，扇区)插入，读请求优先，
+ *       一直有请求到来时远处的请求可能长时间得不到处理
+ * deadline: 队列按到达的顺序排列，也就是读写各自的FIFO，
+ *       队列头完成后一般选择磁头前方最近的请求(单向扫描)，
+ *       最老的读请求超过READ_EXPIRE，或者最老的写请求超过WRITE_EXPIRE时优先处理它，
+ *       读写都超时的时候优先读，但是写最多让给读WRITES_STARVED次
+ *
+ * 都在关中断时调用，next_request在中断中由end_request调用
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/system.h>
+
+#include "blk.h"
+
+#define READ_EXPIRE	(HZ/2)
+#define WRITE_EXPIRE	(5*HZ)
+#define WRITES_STARVED	2
+
+/*
+ * 队列头是正在处理的请求，不能移动，req插入到后面
+ */
+static void sort_add_request(struct blk_dev_struct * dev, struct request * req)
+{
+	struct request * tmp = dev->current_request;
+
+	for ( ;tmp->next; tmp = tmp->next) {
+		/*
+		 * 如果tmp的优先级比req高或者tmp比tmp的下一个的优先级高
+		 * 并且req比tmp的下一个优先高
+		 * 这个算法的目的是让磁头尽可能少的移动从而提高性能
+		 * 电梯算法
+		 */
+		if ((IN_ORDER(tmp, req) || !IN_ORDER(tmp, tmp->next)) &&
+		    (IN_ORDER(req, tmp->next))) {
+			break;
+			}
+	}
+	/*
+	 * 将req插入request链表中
+	 */
+	req->next=tmp->next;
+	tmp->next=req;
+}
+
+static void sort_next_request(struct blk_dev_struct * dev)
+{
+	dev->current_request = dev->current_request->next;
+}
+
+struct elevator elevator_sort = {
+	"sort", sort_add_request, sort_next_request
+};
+
+static void deadline_add_request(struct blk_dev_struct * dev, struct request * req)
+{
+	struct request * tmp = dev->current_request;
+
+	while (tmp->next)
+		tmp = tmp->next;
+	tmp->next = req;
+}
+
+#define expired(req) \
+	((long) (jiffies - (req)->start_time) >= \
+	 ((req)->cmd == READ ? READ_EXPIRE : WRITE_EXPIRE))
+
+/*
+ * 请求a是否在b之前
+ */
+#define BEFORE(a,b) \
+	((a)->dev < (b)->dev || ((a)->dev == (b)->dev && (a)->sector < (b)->sector))
+
+/*
+ * 每个设备连续让给读请求的次数
+ */
+static int writes_starved[NR_BLK_DEV];
+
+/*
+ * 完成的队列头的dev和sector是请求结束时磁头的位置
+ */
+static void deadline_next_request(struct blk_dev_struct * dev)
+{
+	struct request * head = dev->current_request;
+	struct request * first[2] = { NULL, NULL };
+	struct request * next = NULL, * lowest = NULL, * req, ** p;
+	int * starved = writes_starved + (dev - blk_dev);
+
+	for (req = head->next ; req ; req = req->next) {
+		if (!first[req->cmd])
+			first[req->cmd] = req;
+		if (!lowest || BEFORE(req, lowest))
+			lowest = req;
+		if (!BEFORE(req, head) && (!next || BEFORE(req, next)))
+			next = req;
+	}
+	if (!lowest) {
+		dev->current_request = NULL;
+		return;
+	}
+	if (first[READ] && expired(first[READ]) &&
+	    !(first[WRITE] && expired(first[WRITE]) && *starved >= WRITES_STARVED))
+		req = first[READ];
+	else if (first[WRITE] && expired(first[WRITE]))
+		req = first[WRITE];
+	else
+		req = next ? next : lowest;
+	if (req->cmd == WRITE)
+		*starved = 0;
+	else if (first[WRITE])
+		(*starved)++;
+	/*
+	 * 从队列中取出req放到队列头，其他请求保持到达的顺序
+	 */
+	for (p = &head->next ; *p != req ; p = &(*p)->next)
+		/* nothing */ ;
+	*p = req->next;
+	req->next = head->next;
+	dev->current_request = req;
+}
+
+struct elevator elevator_deadline = {
+	"deadline", deadline_add_request, deadline_next_request
+};
+
+/*
+ * 队列头的请求完成，统计延迟后由调度器选择下一个请求
+ */
+void elv_next_request(struct blk_dev_struct * dev)
+{
+	struct request * req = dev->current_request;
+	struct blk_latency * lat = dev->latency + req->cmd;
+	unsigned long t = jiffies - req->start_time;
+
+	lat->nr++;
+	lat->sum += t;
+	if (t > lat->max)
+		lat->max = t;
+	blk_account_done(req);
+	(dev->elevator->next_request)(dev);
+	if (dev->current_request)
+		blk_account_issue(dev->current_request);
+}
+
+/*
+ * 平均和最大延迟，单位为毫秒
+ */
+void blk_show(void)
+{
+	struct blk_latency * lat;
+	int i, rw;
+
+	for (i = 0 ; i < NR_BLK_DEV ; i++) {
+		if (!blk_dev[i].request_fn)
+			continue;
+		for (rw = READ ; rw <= WRITE ; rw++) {
+			lat = blk_dev[i].latency + rw;
+			if (!lat->nr)
+				continue;
+			printk("blk %d %s %s: %d requests, avg %d ms, max %d ms\n\r",
+				i, blk_dev[i].elevator->name, rw == READ ? "read" : "write",
+				lat->nr, lat->sum * 1000 / HZ / lat->nr, lat->max * 1000 / HZ);
+		}
+	}
+}
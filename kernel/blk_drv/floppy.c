@@ -293,6 +293,11 @@ static void rw_interrupt(void)
 	if (command == FD_READ && (unsigned long)(CURRENT->buffer) >= 0x100000)
 		copy_buffer(tmp_floppy_area,CURRENT->buffer);
 	floppy_deselect(current_drive);
+	/*
+	 * 一次只传送一块，合并的请求中还有块时end_request不结束请求
+	 */
+	CURRENT->sector += 2;
+	CURRENT->nr_sectors -= 2;
 	end_request(1);
 	do_fd_request();
 }
@@ -18,6 +18,7 @@
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/hdreg.h>
+#include <linux/pci.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/segment.h>
@@ -41,6 +42,11 @@ inb_p(0x71); \
 #define MAX_ERRORS	7
 #define MAX_HD		2
 
+/*
+ * MAX_MULT 每次中断最多传送的扇区数
+ */
+#define MAX_MULT	16
+
 static void recal_intr(void);
 
 /*
@@ -50,6 +56,22 @@ static void recal_intr(void);
 static int recalibrate = 1;
 static int reset = 1;
 
+/*
+ * setmult 复位后需要重新设置MULTIPLE模式的硬盘，每个硬盘一位
+ */
+static int setmult = 0;
+
+/*
+ * bmide PCI IDE控制器主通道的bus master寄存器端口，0表示只能使用PIO
+ * prd_table 物理区域描述符表，每项为一段内存的物理地址和字节数，
+ * 最后一项的bit31置位，表不能跨越64KB边界
+ */
+static unsigned int bmide = 0;
+static struct prd {
+	unsigned long addr;
+	unsigned long count;
+} prd_table[MAX_SECTORS/2] __attribute__((aligned(MAX_SECTORS/2*8)));
+
 /*
  * This struct defines the HD's and their types.
  * head 磁头数
@@ -58,9 +80,13 @@ static int reset = 1;
  * wpcom 写前预补偿柱面号
  * lzone 磁头着陆区柱面号
  * ctl 控制器字节
+ * lba 0表示使用CHS，28或者48表示LBA的位数，由IDENTIFY得到
+ * mult MULTIPLE模式每次中断传送的扇区数，0表示不使用
+ * dma 硬盘支持DMA，控制器也支持时使用DMA传送
  */
 struct hd_i_struct {
 	int head,sect,cyl,wpcom,lzone,ctl;
+	int lba,mult,dma;
 	};
 #ifdef HD_TYPE
 struct hd_i_struct hd_info[] = { HD_TYPE };
@@ -84,6 +110,69 @@ __asm__("cld;rep;outsw"::"d" (port),"S" (buf),"c" (nr))
 extern void hd_interrupt(void);
 extern void rd_load(void);
 
+static int controller_ready(void);
+
+/*
+ * 用IDENTIFY命令读取硬盘的参数，这时还没有请求，使用查询方式，
+ * 设置nIEN不产生中断
+ */
+static int hd_identify(int drive, unsigned short * id)
+{
+	int i, r = 0;
+
+	if (!controller_ready())
+		return -1;
+	outb_p(hd_info[drive].ctl | CTL_NIEN, HD_CMD);
+	outb_p(0xA0 | (drive << 4), HD_CURRENT);
+	outb_p(WIN_IDENTIFY, HD_COMMAND);
+	for (i = 0; i < 100000; i++)
+		if (!((r = inb_p(HD_STATUS)) & BUSY_STAT))
+			break;
+	if ((r & (BUSY_STAT | ERR_STAT | DRQ_STAT)) == DRQ_STAT)
+		port_read(HD_DATA, id, 256);
+	outb_p(hd_info[drive].ctl, HD_CMD);
+	return ((r & (BUSY_STAT | ERR_STAT | DRQ_STAT)) == DRQ_STAT) ? 0 : -1;
+}
+
+/*
+ * 支持LBA时整个硬盘的扇区数使用IDENTIFY的值，不再受CHS的限制
+ * MULTIPLE模式的扇区数取2的幂
+ */
+static void hd_probe(int drive)
+{
+	unsigned short id[256];
+	unsigned long nr;
+	int mult;
+
+	if (hd_identify(drive, id)) {
+		printk("hd%d: IDENTIFY failed, use CHS\n\r", drive);
+		return;
+	}
+	if (id[ID_CAPABILITY] & 0x200) {
+		hd_info[drive].lba = 28;
+		nr = id[ID_LBA_SECTS] | (id[ID_LBA_SECTS+1] << 16);
+		if ((id[ID_CMD_SET2] & 0x400) && (id[ID_LBA48_SECTS+2] ||
+		    id[ID_LBA48_SECTS+3] || id[ID_LBA48_SECTS+1] >= 0x1000)) {
+			hd_info[drive].lba = 48;
+			nr = id[ID_LBA48_SECTS] | (id[ID_LBA48_SECTS+1] << 16);
+			if (id[ID_LBA48_SECTS+2] || id[ID_LBA48_SECTS+3])
+				nr = 0xffffffff;
+		}
+		if (nr)
+			hd[drive*5].nr_sects = nr;
+	}
+	mult = id[ID_MAX_MULT] & 0xff;
+	if (mult > MAX_MULT)
+		mult = MAX_MULT;
+	while (mult & (mult - 1))
+		mult &= mult - 1;
+	hd_info[drive].mult = (mult > 1) ? mult : 0;
+	hd_info[drive].dma = bmide && (id[ID_CAPABILITY] & 0x100);
+	printk("hd%d: LBA%d, %d sectors, multiple %d, %s\n\r", drive,
+		hd_info[drive].lba, hd[drive*5].nr_sects, hd_info[drive].mult,
+		hd_info[drive].dma ? "DMA" : "PIO");
+}
+
 /* This may be used only once, enforced by 'static int callable' */
 int sys_setup(void * BIOS)
 {
@@ -174,6 +263,8 @@ int sys_setup(void * BIOS)
 		hd[i*5].start_sect = 0;
 		hd[i*5].nr_sects = 0;
 	}
+	for (drive = 0 ; drive < NR_HD ; drive++)
+		hd_probe(drive);
 	/*
 	 * 开始读取两个硬盘的信息
 	 */
@@ -273,6 +364,34 @@ static void hd_out(unsigned int drive,unsigned int nsect,unsigned int sect,
 	outb(cmd,++port);
 }
 
+/*
+ * LBA方式，LBA48时扇区数和地址寄存器写两次，先写高字节
+ */
+static void hd_out_lba(unsigned int drive,unsigned int nsect,unsigned int block,
+		int lba48,unsigned int cmd,void (*intr_addr)(void))
+{
+	if (drive>1)
+		panic("Trying to write bad sector");
+	if (!controller_ready())
+		panic("HD controller not ready");
+	do_hd = intr_addr;
+	outb_p(hd_info[drive].ctl,HD_CMD);
+	if (lba48) {
+		outb_p(0,HD_PRECOMP);
+		outb_p(nsect>>8,HD_NSECTOR);
+		outb_p(block>>24,HD_SECTOR);
+		outb_p(0,HD_LCYL);
+		outb_p(0,HD_HCYL);
+	}
+	outb_p(0,HD_PRECOMP);
+	outb_p(nsect,HD_NSECTOR);
+	outb_p(block,HD_SECTOR);
+	outb_p(block>>8,HD_LCYL);
+	outb_p(block>>16,HD_HCYL);
+	outb_p(0xA0|LBA_FLAG|(drive<<4)|(lba48 ? 0 : (block>>24)&0x0f),HD_CURRENT);
+	outb(cmd,HD_COMMAND);
+}
+
 static int drive_busy(void)
 {
 	unsigned int i;
@@ -326,40 +445,154 @@ static void bad_rw_intr(void)
 		reset = 1;
 }
 
+/*
+ * 一次中断传送的扇区数，MULTIPLE模式下为mult个，最后一次可能不足
+ */
+static inline int block_sectors(void)
+{
+	int n = hd_info[CURRENT_DEV].mult;
+
+	if (!n)
+		return 1;
+	return (CURRENT->nr_sectors < n) ? CURRENT->nr_sectors : n;
+}
+
+/*
+ * 传送了一个扇区，一个请求可能包含多个缓冲块，每个块两个扇区，
+ * 剩下的扇区数为偶数时一块完成，end_request(1)切换到下一块的buffer
+ * 返回剩下的扇区数，为0时请求已经结束，CURRENT已经是下一个请求
+ */
+static inline int sector_done(void)
+{
+	int i;
+
+	CURRENT->sector++;
+	if ((i = --CURRENT->nr_sectors) & 1)
+		CURRENT->buffer += 512;
+	else
+		end_request(1);
+	return i;
+}
+
+/*
+ * 写n个扇区，请求的状态在中断中确认写完以后再修改
+ */
+static void write_sectors(int n)
+{
+	struct buffer_head * bh = CURRENT->bh;
+	char * buf = CURRENT->buffer;
+	int left = CURRENT->nr_sectors;
+
+	while (n--) {
+		port_write(HD_DATA,buf,256);
+		if (--left & 1)
+			buf += 512;
+		else if (bh && (bh = bh->b_reqnext))
+			buf = bh->b_data;
+	}
+}
+
 static void read_intr(void)
 {
+	int i, n;
+
 	if (win_result()) {
 		bad_rw_intr();
 		do_hd_request();
 		return;
 	}
-	port_read(HD_DATA,CURRENT->buffer,256);
 	CURRENT->errors = 0;
-	CURRENT->buffer += 512;
-	CURRENT->sector++;
-	if (--CURRENT->nr_sectors) {
+	n = block_sectors();
+	do {
+		port_read(HD_DATA,CURRENT->buffer,256);
+		i = sector_done();
+	} while (--n);
+	if (i) {
 		do_hd = &read_intr;
 		return;
 	}
-	end_request(1);
 	do_hd_request();
 }
 
 static void write_intr(void)
 {
+	int i, n;
+
 	if (win_result()) {
 		bad_rw_intr();
 		do_hd_request();
 		return;
 	}
-	if (--CURRENT->nr_sectors) {
-		CURRENT->sector++;
-		CURRENT->buffer += 512;
+	n = block_sectors();
+	do {
+		i = sector_done();
+	} while (--n);
+	if (i) {
 		do_hd = &write_intr;
-		port_write(HD_DATA,CURRENT->buffer,256);
+		write_sectors(block_sectors());
+		return;
+	}
+	do_hd_request();
+}
+
+/*
+ * 每个缓冲块一项，物理地址连续的块合并到一项，
+ * 块按1KB对齐，下一块不在64KB边界上时合并后不会跨越边界
+ * 一项正好是64KB时count为0x10000，第16位是保留位，
+ * 结束一项时只保留低16位，0表示64KB
+ * 内核的地址就是物理地址
+ */
+static void build_prd(void)
+{
+	struct buffer_head * bh = CURRENT->bh;
+	struct prd * p = prd_table;
+	unsigned long addr;
+
+	p->addr = (unsigned long) CURRENT->buffer;
+	p->count = (CURRENT->nr_sectors & 1) ? 512 : BLOCK_SIZE;
+	while ((bh = bh->b_reqnext)) {
+		addr = (unsigned long) bh->b_data;
+		if (addr == p->addr + p->count && (addr & 0xffff))
+			p->count += BLOCK_SIZE;
+		else {
+			p->count &= 0xffff;
+			p++;
+			p->addr = addr;
+			p->count = BLOCK_SIZE;
+		}
+	}
+	p->count = (p->count & 0xffff) | 0x80000000;
+}
+
+/*
+ * 整个请求传送完成后才产生一次中断
+ * 出错时这个硬盘改为使用PIO
+ */
+static void dma_intr(void)
+{
+	int stat;
+
+	outb(inb(bmide + BM_COMMAND) & ~BM_CMD_START, bmide + BM_COMMAND);
+	stat = inb(bmide + BM_STATUS);
+	outb(stat | BM_STAT_ERR | BM_STAT_INTR, bmide + BM_STATUS);
+	if (win_result() || (stat & BM_STAT_ERR)) {
+		printk("hd%d: DMA error, use PIO\n\r", CURRENT_DEV);
+		hd_info[CURRENT_DEV].dma = 0;
+		bad_rw_intr();
+		do_hd_request();
 		return;
 	}
-	end_request(1);
+	while (sector_done())
+		/* nothing */ ;
+	do_hd_request();
+}
+
+static void setmult_intr(void)
+{
+	if (win_result()) {
+		printk("hd%d: set multiple mode failed\n\r", CURRENT_DEV);
+		hd_info[CURRENT_DEV].mult = 0;
+	}
 	do_hd_request();
 }
 
@@ -370,12 +603,29 @@ static void recal_intr(void)
 	do_hd_request();
 }
 
+/*
+ * 超过LBA28范围时使用的命令
+ */
+static unsigned int ext_cmd(unsigned int cmd)
+{
+	switch (cmd) {
+		case WIN_READ: return WIN_READ_EXT;
+		case WIN_WRITE: return WIN_WRITE_EXT;
+		case WIN_MULTREAD: return WIN_MULTREAD_EXT;
+		case WIN_MULTWRITE: return WIN_MULTWRITE_EXT;
+		case WIN_READDMA: return WIN_READDMA_EXT;
+		default: return WIN_WRITEDMA_EXT;
+	}
+}
+
 void do_hd_request(void)
 {
 	int i,r = 0;
 	unsigned int block,dev;
 	unsigned int sec,head,cyl;
-	unsigned int nsect;
+	unsigned int nsect,cmd;
+	int lba48,dma;
+	void (*intr)(void);
 
 	/*
 	 * 定义repeat标记
@@ -397,7 +647,7 @@ void do_hd_request(void)
 	 * 判断次设备号
 	 * 判断读取扇区号是否在此分区合理范围内
 	 */
-	if (dev >= 5*NR_HD || (block+2) > (hd[dev].start_sect + hd[dev].nr_sects - 1)) {
+	if (dev >= 5*NR_HD || (block+CURRENT->nr_sectors) > (hd[dev].start_sect + hd[dev].nr_sects - 1)) {
 		end_request(0);
 		goto repeat;
 	}
@@ -412,18 +662,11 @@ void do_hd_request(void)
 		printk("SuperBlock sectors is %d 0x%x offset in disk\n", 
 			block, block*512);
 	}
-	/*
-	 * 下面根据dev和block获取sec，head，cyl等硬盘参数
-	 */
-	__asm__("divl %4":"=a" (block),"=d" (sec):"0" (block),"1" (0),
-		"r" (hd_info[dev].sect));
-	__asm__("divl %4":"=a" (cyl),"=d" (head):"0" (block),"1" (0),
-		"r" (hd_info[dev].head));
-	sec++;
 	nsect = CURRENT->nr_sectors;
 	if (reset) {
 		reset = 0;
 		recalibrate = 1;
+		setmult = (1 << NR_HD) - 1;
 		reset_hd(CURRENT_DEV);
 		return;
 	}
@@ -432,24 +675,98 @@ void do_hd_request(void)
 		hd_out(dev,hd_info[CURRENT_DEV].sect,0,0,0,
 			WIN_RESTORE,&recal_intr);
 		return;
-	}	
+	}
+	/*
+	 * 复位后MULTIPLE模式失效，需要重新设置
+	 */
+	if (setmult & (1 << dev)) {
+		setmult &= ~(1 << dev);
+		if (hd_info[dev].mult) {
+			hd_out(dev,hd_info[dev].mult,0,0,0,
+				WIN_SETMULT,&setmult_intr);
+			return;
+		}
+	}
+	dma = bmide && hd_info[dev].dma;
+	if (CURRENT->cmd == WRITE) {
+		cmd = dma ? WIN_WRITEDMA :
+			hd_info[dev].mult ? WIN_MULTWRITE : WIN_WRITE;
+		intr = dma ? &dma_intr : &write_intr;
+	} else if (CURRENT->cmd == READ) {
+		cmd = dma ? WIN_READDMA :
+			hd_info[dev].mult ? WIN_MULTREAD : WIN_READ;
+		intr = dma ? &dma_intr : &read_intr;
+	} else
+		panic("unknown hd-command");
+	/*
+	 * DMA先设置PRD表和方向，发出命令后再启动
+	 */
+	if (dma) {
+		build_prd();
+		outl((unsigned long) prd_table, bmide + BM_PRD);
+		outb((CURRENT->cmd == READ) ? BM_CMD_READ : 0, bmide + BM_COMMAND);
+		outb(inb(bmide + BM_STATUS) | BM_STAT_ERR | BM_STAT_INTR,
+			bmide + BM_STATUS);
+	}
+	/*
+	 * 支持LBA时直接使用扇区号，超过LBA28的范围时使用LBA48的命令
+	 * 否则根据dev和block获取sec，head，cyl等硬盘参数
+	 */
+	if (hd_info[dev].lba) {
+		if ((lba48 = (block + nsect > 0x0fffffff)))
+			cmd = ext_cmd(cmd);
+		hd_out_lba(dev, nsect, block, lba48, cmd, intr);
+	} else {
+		__asm__("divl %4":"=a" (block),"=d" (sec):"0" (block),"1" (0),
+			"r" (hd_info[dev].sect));
+		__asm__("divl %4":"=a" (cyl),"=d" (head):"0" (block),"1" (0),
+			"r" (hd_info[dev].head));
+		sec++;
+		hd_out(dev, nsect, sec, head, cyl, cmd, intr);
+	}
+	if (dma) {
+		outb(inb(bmide + BM_COMMAND) | BM_CMD_START, bmide + BM_COMMAND);
+		return;
+	}
+	/*
+	 * 写命令的第一块数据不产生中断，等待DRQ后写入
+	 */
 	if (CURRENT->cmd == WRITE) {
-		hd_out(dev, nsect, sec, head, cyl, WIN_WRITE, &write_intr);
 		for(i = 0; i < 3000 && !(r = inb_p(HD_STATUS)&DRQ_STAT); i++)
 			/* nothing */ ;
 		if (!r) {
 			bad_rw_intr();
 			goto repeat;
 		}
-		port_write(HD_DATA,CURRENT->buffer,256);
-	} else if (CURRENT->cmd == READ) {
-		hd_out(dev, nsect, sec, head, cyl, WIN_READ, &read_intr);
-	} else
-		panic("unknown hd-command");
+		write_sectors(block_sectors());
+	}
+}
+
+/*
+ * 查找兼容模式的PCI IDE控制器，编程接口bit7表示支持bus master，
+ * bit0表示主通道为native模式，端口不是0x1f0，不使用
+ */
+static void hd_dma_init(void)
+{
+	struct pci_dev * dev;
+	unsigned long base;
+
+	if (!(dev = pci_find_class(PCI_CLASS_STORAGE_IDE, NULL)))
+		return;
+	if (!(dev->class & 0x80) || (dev->class & 0x01))
+		return;
+	base = pci_read_config_dword(dev, PCI_BASE_ADDRESS_4);
+	if (!(base & 0x01) || !(base & PCI_BASE_ADDRESS_IO_MASK))
+		return;
+	pci_write_config_word(dev, PCI_COMMAND, pci_read_config_word(dev, PCI_COMMAND)
+		| PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+	bmide = base & PCI_BASE_ADDRESS_IO_MASK;
+	printk("ide: bus master DMA at 0x%x\n\r", bmide);
 }
 
 void hd_init(void)
 {
+	hd_dma_init();
 	blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
 	set_intr_gate(0x2E,&hd_interrupt);
 	outb_p(inb_p(0x21)&0xfb,0x21);
@@ -0,0 +1,215 @@
+/*
+ *  linux/kernel/blk_drv/iostat.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 块设备I/O统计
+ *
+ * add_request时请求进入队列，成为队列头交给驱动程序时开始处理，
+ * end_request中完成，三个时间点的差值分别计入queue_time和service_time
+ * 合并在make_request中统计，扇区数在请求进入队列和合并时统计
+ *
+ * 都在关中断时调用，用do_monotonic得到微秒的时间
+ */
+#include <errno.h>
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/time.h>
+#include <linux/iostat.h>
+#include <asm/system.h>
+#include <asm/segment.h>
+
+#include "blk.h"
+
+#define NR_DISK_STAT	16
+
+extern struct cache_stat cache_stats;
+
+/*
+ * blk_stats为每个主设备的总计，disk_stats为次设备，major为0表示没有使用
+ */
+static struct disk_stat blk_stats[NR_BLK_DEV];
+static struct disk_stat disk_stats[NR_DISK_STAT];
+
+static unsigned long blk_clock(void)
+{
+	struct timespec ts;
+
+	do_monotonic(&ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * 表满时次设备不统计，只统计主设备
+ */
+static struct disk_stat * find_disk_stat(int dev)
+{
+	struct disk_stat * s, * free = NULL;
+
+	for (s = disk_stats ; s < disk_stats + NR_DISK_STAT ; s++) {
+		if (!s->major) {
+			if (!free)
+				free = s;
+		} else if (s->major == MAJOR(dev) && s->minor == MINOR(dev))
+			return s;
+	}
+	if (free) {
+		free->major = MAJOR(dev);
+		free->minor = MINOR(dev);
+		free->stamp = blk_clock();
+	}
+	return free;
+}
+
+/*
+ * 队列中的请求数变化之前累计io_time和weighted_time
+ */
+static void update_in_flight(struct disk_stat * s, unsigned long now, int delta)
+{
+	unsigned long t = now - s->stamp;
+
+	if (s->in_flight) {
+		s->io_time += t;
+		s->weighted_time += (unsigned long long) t * s->in_flight;
+	}
+	s->stamp = now;
+	s->in_flight += delta;
+}
+
+void blk_account_queue(struct request * req)
+{
+	struct disk_stat * s = blk_stats + MAJOR(req->dev);
+	unsigned long now = blk_clock();
+
+	req->stat = find_disk_stat(req->dev);
+	req->queue_us = req->issue_us = now;
+	s->sectors[req->cmd] += req->nr_sectors;
+	update_in_flight(s, now, 1);
+	if ((s = req->stat)) {
+		s->sectors[req->cmd] += req->nr_sectors;
+		update_in_flight(s, now, 1);
+	}
+}
+
+void blk_account_merge(struct request * req)
+{
+	struct disk_stat * s = blk_stats + MAJOR(req->dev);
+
+	s->merges[req->cmd]++;
+	s->sectors[req->cmd] += 2;
+	if ((s = req->stat)) {
+		s->merges[req->cmd]++;
+		s->sectors[req->cmd] += 2;
+	}
+}
+
+void blk_account_issue(struct request * req)
+{
+	req->issue_us = blk_clock();
+}
+
+void blk_account_done(struct request * req)
+{
+	struct disk_stat * s = blk_stats + MAJOR(req->dev);
+	unsigned long now = blk_clock();
+	int rw = req->cmd;
+
+	s->ios[rw]++;
+	s->queue_time[rw] += req->issue_us - req->queue_us;
+	s->service_time[rw] += now - req->issue_us;
+	update_in_flight(s, now, -1);
+	if ((s = req->stat)) {
+		s->ios[rw]++;
+		s->queue_time[rw] += req->issue_us - req->queue_us;
+		s->service_time[rw] += now - req->issue_us;
+		update_in_flight(s, now, -1);
+	}
+}
+
+static void reset_stat(struct disk_stat * s, unsigned long now)
+{
+	short major = s->major, minor = s->minor;
+	unsigned long in_flight = s->in_flight;
+
+	memset(s, 0, sizeof (*s));
+	s->major = major;
+	s->minor = minor;
+	s->in_flight = in_flight;
+	s->stamp = now;
+}
+
+/*
+ * 复制前先累计到当前时间，size为buf的字节数
+ * 返回复制的项数，buf不够时为0，地址出错时为-EFAULT
+ */
+static int copy_stat(struct disk_stat * s, char ** buf, int * size)
+{
+	struct disk_stat tmp;
+	unsigned long flags;
+
+	if (*size < (int) sizeof (struct disk_stat))
+		return 0;
+	local_irq_disable(flags);
+	update_in_flight(s, blk_clock(), 0);
+	tmp = *s;
+	local_irq_restore(flags);
+	verify_area(*buf, sizeof (struct disk_stat));
+	if (copy_to_user(*buf, &tmp, sizeof (struct disk_stat)))
+		return -EFAULT;
+	*buf += sizeof (struct disk_stat);
+	*size -= sizeof (struct disk_stat);
+	return 1;
+}
+
+int sys_iostat(int cmd, char * buf, int size)
+{
+	unsigned long flags, now;
+	int i, r, n = 0;
+
+	switch (cmd) {
+		case IOSTAT_GET_DISK:
+			for (i = 0 ; i < NR_BLK_DEV ; i++)
+				if (blk_dev[i].request_fn) {
+					blk_stats[i].major = i;
+					blk_stats[i].minor = -1;
+					if ((r = copy_stat(blk_stats + i, &buf, &size)) < 0)
+						return n?n:r;
+					n += r;
+				}
+			for (i = 0 ; i < NR_DISK_STAT ; i++)
+				if (disk_stats[i].major) {
+					if ((r = copy_stat(disk_stats + i, &buf, &size)) < 0)
+						return n?n:r;
+					n += r;
+				}
+			return n;
+		case IOSTAT_GET_CACHE:
+			n = sizeof (cache_stats);
+			if (size < n)
+				n = size;
+			if (n <= 0)
+				return -EINVAL;
+			verify_area(buf, n);
+			if (copy_to_user(buf, &cache_stats, n))
+				return -EFAULT;
+			return n;
+		case IOSTAT_RESET:
+			if (!suser())
+				return -EPERM;
+			local_irq_disable(flags);
+			now = blk_clock();
+			for (i = 0 ; i < NR_BLK_DEV ; i++)
+				reset_stat(blk_stats + i, now);
+			for (i = 0 ; i < NR_DISK_STAT ; i++)
+				if (disk_stats[i].major)
+					reset_stat(disk_stats + i, now);
+			memset(&cache_stats, 0, sizeof (cache_stats));
+			local_irq_restore(flags);
+			return 0;
+	}
+	return -EINVAL;
+}
@@ -56,6 +56,34 @@ static inline void unlock_buffer(struct buffer_head * bh)
 	wake_up(&bh->b_wait);
 }
 
+/*
+ * 有设备的队列处于plug状态，schedule和时钟中断中检查
+ */
+int blk_plugged = 0;
+
+/*
+ * 把plug的队列交给驱动程序，在schedule中进程要睡眠时调用，
+ * 这时连续发出的请求都已经在队列中合并了
+ * 时钟中断中也调用，保证一个滴答之内开始
+ */
+void blk_unplug(void)
+{
+	struct blk_dev_struct * dev;
+	unsigned long flags;
+
+	local_irq_disable(flags);
+	blk_plugged = 0;
+	for (dev = blk_dev ; dev < blk_dev + NR_BLK_DEV ; dev++)
+		if (dev->plugged) {
+			dev->plugged = 0;
+			if (dev->current_request) {
+				blk_account_issue(dev->current_request);
+				(dev->request_fn)();
+			}
+		}
+	local_irq_restore(flags);
+}
+
 /*
  * add-request adds a request to the linked list.
  * It disables interrupts so that it can muck with the
@@ -63,40 +91,63 @@ static inline void unlock_buffer(struct buffer_head * bh)
  */
 static void add_request(struct blk_dev_struct * dev, struct request * req)
 {
-	struct request * tmp;
-
 	req->next = NULL;
 	cli();
 	if (req->bh)
 		req->bh->b_dirt = 0;
+	blk_account_queue(req);
 	/*
 	 * 如果dev当前的请求项为空，表示当前设备没有请求项
 	 * 因此将req作为当前请求项，并立即进行request回调
 	 */
-	if (!(tmp = dev->current_request)) {
+	if (!dev->current_request) {
 		dev->current_request = req;
+		dev->plugged = 1;
+		blk_plugged = 1;
 		sti();
-		(dev->request_fn)();
 		return;
 	}
-	for ( ;tmp->next; tmp = tmp->next) {
-		/*
-		 * 如果tmp的优先级比req高或者tmp比tmp的下一个的优先级高
-		 * 并且req比tmp的下一个优先高
-		 * 这个算法的目的是让磁头尽可能少的移动从而提高性能
-		 * 电梯算法
-		 */
-		if ((IN_ORDER(tmp, req) || !IN_ORDER(tmp, tmp->next)) &&
-		    (IN_ORDER(req, tmp->next))) {
-			break;
-			}
-	}
 	/*
-	 * 将req插入request链表中
+	 * 由I/O调度器决定req在队列中的位置
 	 */
-	req->next=tmp->next;
-	tmp->next=req;
+	(dev->elevator->add_request)(dev, req);
+	sti();
+}
+
+/*
+ * 和队列中同一设备同一方向的请求合并，bh接在请求的后面或者前面
+ * 驱动程序正在处理的请求(没有plug时的队列头)不能合并
+ */
+static int merge_request(struct blk_dev_struct * dev, int rw, struct buffer_head * bh)
+{
+	struct request * req;
+	unsigned long sector = bh->b_blocknr << 1;
+
+	cli();
+	if ((req = dev->current_request) && !dev->plugged)
+		req = req->next;
+	for ( ; req ; req = req->next) {
+		if (req->dev != bh->b_dev || req->cmd != rw || !req->bh ||
+		    req->nr_sectors + 2 > MAX_SECTORS)
+			continue;
+		if (req->sector + req->nr_sectors == sector) {
+			req->bhtail->b_reqnext = bh;
+			req->bhtail = bh;
+		} else if (sector + 2 == req->sector) {
+			bh->b_reqnext = req->bh;
+			req->bh = bh;
+			req->buffer = bh->b_data;
+			req->sector = sector;
+		} else
+			continue;
+		req->nr_sectors += 2;
+		bh->b_dirt = 0;
+		blk_account_merge(req);
+		sti();
+		return 1;
+	}
 	sti();
+	return 0;
 }
 
 static void make_request(int major, int rw, struct buffer_head * bh)
@@ -152,7 +203,10 @@ static void make_request(int major, int rw, struct buffer_head * bh)
 		unlock_buffer(bh);
 		return;
 	}
+	bh->b_reqnext = NULL;
 repeat:
+	if (merge_request(major + blk_dev, rw, bh))
+		return;
 	/* we don't allow the write-requests to fill up the queue completely:
 	 * we want some room for reads: they take precedence. The last third
 	 * of the requests are only for reads.
@@ -206,6 +260,8 @@ repeat:
 	req->buffer = bh->b_data;
 	req->waiting = NULL;
 	req->bh = bh;
+	req->bhtail = bh;
+	req->start_time = jiffies;
 	req->next = NULL;
 	/*
 	 * major是主设备号
@@ -234,4 +290,7 @@ void blk_dev_init(void)
 		request[i].dev = -1;
 		request[i].next = NULL;
 	}
+	for (i=0 ; i<NR_BLK_DEV ; i++)
+		blk_dev[i].elevator = &DEFAULT_ELEVATOR;
+	printk("I/O scheduler: %s\n\r", DEFAULT_ELEVATOR.name);
 }
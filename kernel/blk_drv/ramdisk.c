@@ -35,7 +35,7 @@ void do_rd_request(void)
 	 * 左移8位，表示乘以512
 	 */
 	addr = rd_start + (CURRENT->sector << 9);
-	len = CURRENT->nr_sectors << 9;
+	len = BLOCK_SIZE;
 	/*
 	 * 如果子设备号不是1，或者地址不在RAMDISK地址空间内，结束该请求
 	 */
@@ -46,7 +46,7 @@ void do_rd_request(void)
 	/*
 	 * 如果是写，将buffer数据拷贝到addr处
 	 * 如果是读，将addr数据拷贝到buffer处
-	 * 一共拷贝len个字节
+	 * 合并的请求中各块的buffer不连续，每次拷贝一块
 	 */
 	if (CURRENT-> cmd == WRITE) {
 		(void) memcpy(addr, CURRENT->buffer, len);
@@ -57,6 +57,8 @@ void do_rd_request(void)
 	/*
 	 * 成功后设置更新标志
 	 */
+	CURRENT->sector += 2;
+	CURRENT->nr_sectors -= 2;
 	end_request(1);
 	goto repeat;
 }
@@ -87,7 +89,7 @@ long rd_init(long mem_start, int length)
 #ifdef RAMDISK_START
 #define ramdisk_start RAMDISK_START
 #else
-#define ramdisk_start 256 /* Start at block 256 by default */
+#define ramdisk_start 320 /* Start at block 320 by default */
 #endif
 
 /*
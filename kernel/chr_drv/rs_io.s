@@ -48,6 +48,9 @@ rs_int:
 	pop %ds
 	pushl $0x10
 	pop %es
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	movl 24(%esp),%edx
 	movl (%edx),%edx
 	movl rs_addr(%edx),%edx
@@ -67,6 +70,9 @@ rep_int:
 	jmp rep_int
 end:	movb $0x20,%al
 	outb %al,$0x20		/* EOI */
+.ifdef CONFIG_SMP
+	call unlock_kernel
+.endif
 	pop %ds
 	pop %es
 	popl %eax
@@ -110,6 +116,19 @@ read_char:
 	addl $4,%esp
 	ret
 
+.align 4
+# 通过wake_up唤醒，select/poll的进程也能被唤醒
+wake_writer:
+	pushl %ecx
+	pushl %edx
+	leal proc_list(%ecx),%ebx
+	pushl %ebx
+	call wake_up
+	addl $4,%esp
+	popl %edx
+	popl %ecx
+	ret
+
 .align 4
 write_char:
 	movl 4(%ecx),%ecx		# write-queue
@@ -119,10 +138,7 @@ write_char:
 	je write_buffer_empty
 	cmpl $startup,%ebx
 	ja 1f
-	movl proc_list(%ecx),%ebx	# wake up sleeping process
-	testl %ebx,%ebx			# is there any?
-	je 1f
-	movl $0,(%ebx)
+	call wake_writer		# wake up sleeping process
 1:	movl tail(%ecx),%ebx
 	movb buf(%ecx,%ebx),%al
 	outb %al,%dx
@@ -134,11 +150,8 @@ write_char:
 	ret
 .align 4
 write_buffer_empty:
-	movl proc_list(%ecx),%ebx	# wake up sleeping process
-	testl %ebx,%ebx			# is there any?
-	je 1f
-	movl $0,(%ebx)
-1:	incl %edx
+	call wake_writer		# wake up sleeping process
+	incl %edx
 	inb %dx,%al
 	jmp 1f
 1:	jmp 1f
@@ -288,6 +288,32 @@ int tty_read(unsigned channel, char * buf, int nr)
 	return (b-buf);
 }
 
+/*
+ * 规范模式下和tty_read一样，要等到一整行
+ */
+int tty_select(unsigned channel, int flag, struct select_table * wait)
+{
+	struct tty_struct * tty;
+	int mask = 0;
+
+	if (channel>2)
+		return flag & (SEL_IN | SEL_OUT);
+	tty = channel + tty_table;
+	if (!EMPTY(tty->secondary) && (!L_CANON(tty) ||
+	    tty->secondary.data || LEFT(tty->secondary)<=20))
+		mask |= SEL_IN;
+	if (!FULL(tty->write_q))
+		mask |= SEL_OUT;
+	mask &= flag;
+	if (!mask) {
+		if (flag & SEL_IN)
+			select_wait(&tty->secondary.proc_list, wait);
+		if (flag & SEL_OUT)
+			select_wait(&tty->write_q.proc_list, wait);
+	}
+	return mask;
+}
+
 int tty_write(unsigned channel, char * buf, int nr)
 {
 	static int cr_flag=0;
@@ -25,6 +25,8 @@ void release(struct task_struct * p)
 	for (i=1 ; i<NR_TASKS ; i++)
 		if (task[i]==p) {
 			task[i]=NULL;
+			if (p->policy != SCHED_OTHER)
+				nr_rt_tasks--;
 			free_page((long)p);
 			schedule();
 			return;
@@ -125,6 +127,7 @@ int do_exit(long code)
 		tty_table[current->tty].pgrp = 0;
 	if (last_task_used_math == current)
 		last_task_used_math = NULL;
+	systrace_untrace(current);
 	if (current->leader)
 		kill_session();
 	current->state = TASK_ZOMBIE;
@@ -102,6 +102,30 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	p->utime = p->stime = 0;
 	p->cutime = p->cstime = 0;
 	p->start_time = jiffies;
+	p->trace = 0;
+#ifdef CONFIG_FAIR_SCHED
+	/*
+	 * 子进程继承父进程的vruntime和nice，在schedule中加入运行队列
+	 */
+	p->on_rq = 0;
+	p->in_tree = 0;
+#endif
+	/*
+	 * 实时进程的子进程继承调度策略
+	 */
+	if (p->policy != SCHED_OTHER) {
+		nr_rt_tasks++;
+		if (p->policy == SCHED_RR)
+			p->counter = RR_TIMESLICE;
+	}
+#ifdef CONFIG_SMP
+	/*
+	 * 新进程放到负载最轻的CPU上，第一次返回用户态时释放大内核锁
+	 */
+	p->processor = smp_pick_cpu();
+	p->has_cpu = 0;
+	p->lock_depth = 1;
+#endif
 
 #ifdef CONFIG_SWITCH_TSS
 	p->tss.back_link = 0;
@@ -0,0 +1,132 @@
+/*
+ *  linux/kernel/pci.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * PCI总线枚举
+ *
+ * 使用配置机制1：向0xCF8写入(总线，设备，功能，寄存器)，再从0xCFC读写数据
+ * 启动时从总线0开始扫描，遇到PCI桥时扫描它的下级总线，
+ * 找到的设备记录在pci_devices中，驱动程序初始化时用pci_find_class查找
+ */
+#include <stddef.h>
+
+#include <linux/kernel.h>
+#include <linux/pci.h>
+#include <asm/system.h>
+#include <asm/io.h>
+
+struct pci_dev pci_devices[NR_PCI_DEV];
+int nr_pci_devices = 0;
+
+#define CONFIG_CMD(dev,where) \
+	(0x80000000 | ((dev)->bus << 16) | ((dev)->devfn << 8) | ((where) & ~3))
+
+unsigned long pci_read_config_dword(struct pci_dev * dev, int where)
+{
+	unsigned long flags, val;
+
+	local_irq_disable(flags);
+	outl(CONFIG_CMD(dev, where), PCI_CONFIG_ADDR);
+	val = inl(PCI_CONFIG_DATA);
+	local_irq_restore(flags);
+	return val;
+}
+
+unsigned short pci_read_config_word(struct pci_dev * dev, int where)
+{
+	return pci_read_config_dword(dev, where) >> ((where & 2) << 3);
+}
+
+unsigned char pci_read_config_byte(struct pci_dev * dev, int where)
+{
+	return pci_read_config_dword(dev, where) >> ((where & 3) << 3);
+}
+
+void pci_write_config_dword(struct pci_dev * dev, int where, unsigned long val)
+{
+	unsigned long flags;
+
+	local_irq_disable(flags);
+	outl(CONFIG_CMD(dev, where), PCI_CONFIG_ADDR);
+	outl(val, PCI_CONFIG_DATA);
+	local_irq_restore(flags);
+}
+
+void pci_write_config_word(struct pci_dev * dev, int where, unsigned short val)
+{
+	unsigned long flags;
+
+	local_irq_disable(flags);
+	outl(CONFIG_CMD(dev, where), PCI_CONFIG_ADDR);
+	outw(val, PCI_CONFIG_DATA + (where & 2));
+	local_irq_restore(flags);
+}
+
+/*
+ * from为NULL时从头开始查找，否则从from的下一个开始
+ * class为类别和子类别，不比较编程接口
+ */
+struct pci_dev * pci_find_class(unsigned int class, struct pci_dev * from)
+{
+	struct pci_dev * dev = from ? from + 1 : pci_devices;
+
+	for ( ; dev < pci_devices + nr_pci_devices ; dev++)
+		if ((dev->class >> 8) == class)
+			return dev;
+	return NULL;
+}
+
+static void pci_scan_bus(int bus)
+{
+	struct pci_dev tmp, * dev;
+	unsigned long id;
+	int slot, func, nfunc, sec;
+
+	tmp.bus = bus;
+	for (slot = 0 ; slot < 32 ; slot++) {
+		nfunc = 1;
+		for (func = 0 ; func < nfunc ; func++) {
+			tmp.devfn = PCI_DEVFN(slot, func);
+			id = pci_read_config_dword(&tmp, PCI_VENDOR_ID);
+			if ((id & 0xffff) == 0xffff || !(id & 0xffff))
+				continue;
+			if (!func && (pci_read_config_byte(&tmp, PCI_HEADER_TYPE) & 0x80))
+				nfunc = 8;
+			if (nr_pci_devices >= NR_PCI_DEV) {
+				printk("pci: too many devices\n\r");
+				return;
+			}
+			dev = pci_devices + nr_pci_devices++;
+			*dev = tmp;
+			dev->vendor = id & 0xffff;
+			dev->device = id >> 16;
+			dev->class = pci_read_config_dword(dev, PCI_CLASS_REVISION) >> 8;
+			dev->irq = pci_read_config_byte(dev, PCI_INTERRUPT_LINE);
+			printk("pci %02x:%02x.%d %04x:%04x class %06x irq %d\n\r",
+				bus, slot, func, dev->vendor, dev->device,
+				dev->class, dev->irq);
+			/*
+			 * 没有配置的桥下级总线号为0，不扫描
+			 */
+			if ((dev->class >> 8) == PCI_CLASS_BRIDGE_PCI &&
+			    (sec = pci_read_config_byte(dev, PCI_SECONDARY_BUS)) > bus)
+				pci_scan_bus(sec);
+		}
+	}
+}
+
+/*
+ * 写入地址端口后能读回，说明支持配置机制1
+ */
+void pci_init(void)
+{
+	outl(0x80000000, PCI_CONFIG_ADDR);
+	if (inl(PCI_CONFIG_ADDR) != 0x80000000) {
+		printk("pci: not found\n\r");
+		return;
+	}
+	pci_scan_bus(0);
+}
@@ -0,0 +1,269 @@
+/*
+ *  linux/kernel/rbtree.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 红黑树的插入和删除后的平衡操作，性质：
+ * 1. 节点是红色或者黑色，根节点是黑色
+ * 2. 红色节点的子节点都是黑色
+ * 3. 从任一节点到其下所有叶子的路径上黑色节点数目相同
+ * 因此最长路径不超过最短路径的两倍，查找，插入，删除都是O(logn)
+ */
+#include <linux/rbtree.h>
+
+static void rb_rotate_left(struct rb_node * node, struct rb_root * root)
+{
+	struct rb_node * right = node->rb_right;
+
+	if ((node->rb_right = right->rb_left))
+		right->rb_left->rb_parent = node;
+	right->rb_left = node;
+
+	if ((right->rb_parent = node->rb_parent)) {
+		if (node == node->rb_parent->rb_left)
+			node->rb_parent->rb_left = right;
+		else
+			node->rb_parent->rb_right = right;
+	} else
+		root->rb_node = right;
+	node->rb_parent = right;
+}
+
+static void rb_rotate_right(struct rb_node * node, struct rb_root * root)
+{
+	struct rb_node * left = node->rb_left;
+
+	if ((node->rb_left = left->rb_right))
+		left->rb_right->rb_parent = node;
+	left->rb_right = node;
+
+	if ((left->rb_parent = node->rb_parent)) {
+		if (node == node->rb_parent->rb_right)
+			node->rb_parent->rb_right = left;
+		else
+			node->rb_parent->rb_left = left;
+	} else
+		root->rb_node = left;
+	node->rb_parent = left;
+}
+
+/*
+ * 新插入的节点是红色，如果父节点也是红色则需要调整
+ * 叔节点为红色时只改变颜色，然后从祖父节点继续向上
+ * 叔节点为黑色时通过一到两次旋转完成
+ */
+void rb_insert_color(struct rb_node * node, struct rb_root * root)
+{
+	struct rb_node * parent, * gparent, * uncle, * tmp;
+
+	while ((parent = node->rb_parent) && parent->rb_color == RB_RED) {
+		gparent = parent->rb_parent;
+
+		if (parent == gparent->rb_left) {
+			uncle = gparent->rb_right;
+			if (uncle && uncle->rb_color == RB_RED) {
+				uncle->rb_color = RB_BLACK;
+				parent->rb_color = RB_BLACK;
+				gparent->rb_color = RB_RED;
+				node = gparent;
+				continue;
+			}
+			if (parent->rb_right == node) {
+				rb_rotate_left(parent, root);
+				tmp = parent;
+				parent = node;
+				node = tmp;
+			}
+			parent->rb_color = RB_BLACK;
+			gparent->rb_color = RB_RED;
+			rb_rotate_right(gparent, root);
+		} else {
+			uncle = gparent->rb_left;
+			if (uncle && uncle->rb_color == RB_RED) {
+				uncle->rb_color = RB_BLACK;
+				parent->rb_color = RB_BLACK;
+				gparent->rb_color = RB_RED;
+				node = gparent;
+				continue;
+			}
+			if (parent->rb_left == node) {
+				rb_rotate_right(parent, root);
+				tmp = parent;
+				parent = node;
+				node = tmp;
+			}
+			parent->rb_color = RB_BLACK;
+			gparent->rb_color = RB_RED;
+			rb_rotate_left(gparent, root);
+		}
+	}
+
+	root->rb_node->rb_color = RB_BLACK;
+}
+
+/*
+ * 删除了一个黑色节点后，node所在的路径少了一个黑色节点，
+ * 通过兄弟节点(other)借一个黑色节点或者把缺少的黑色向上传递
+ */
+static void rb_erase_color(struct rb_node * node, struct rb_node * parent,
+			   struct rb_root * root)
+{
+	struct rb_node * other;
+
+	while ((!node || node->rb_color == RB_BLACK) && node != root->rb_node) {
+		if (parent->rb_left == node) {
+			other = parent->rb_right;
+			if (other->rb_color == RB_RED) {
+				other->rb_color = RB_BLACK;
+				parent->rb_color = RB_RED;
+				rb_rotate_left(parent, root);
+				other = parent->rb_right;
+			}
+			if ((!other->rb_left || other->rb_left->rb_color == RB_BLACK) &&
+			    (!other->rb_right || other->rb_right->rb_color == RB_BLACK)) {
+				other->rb_color = RB_RED;
+				node = parent;
+				parent = node->rb_parent;
+			} else {
+				if (!other->rb_right || other->rb_right->rb_color == RB_BLACK) {
+					if (other->rb_left)
+						other->rb_left->rb_color = RB_BLACK;
+					other->rb_color = RB_RED;
+					rb_rotate_right(other, root);
+					other = parent->rb_right;
+				}
+				other->rb_color = parent->rb_color;
+				parent->rb_color = RB_BLACK;
+				if (other->rb_right)
+					other->rb_right->rb_color = RB_BLACK;
+				rb_rotate_left(parent, root);
+				node = root->rb_node;
+				break;
+			}
+		} else {
+			other = parent->rb_left;
+			if (other->rb_color == RB_RED) {
+				other->rb_color = RB_BLACK;
+				parent->rb_color = RB_RED;
+				rb_rotate_right(parent, root);
+				other = parent->rb_left;
+			}
+			if ((!other->rb_left || other->rb_left->rb_color == RB_BLACK) &&
+			    (!other->rb_right || other->rb_right->rb_color == RB_BLACK)) {
+				other->rb_color = RB_RED;
+				node = parent;
+				parent = node->rb_parent;
+			} else {
+				if (!other->rb_left || other->rb_left->rb_color == RB_BLACK) {
+					if (other->rb_right)
+						other->rb_right->rb_color = RB_BLACK;
+					other->rb_color = RB_RED;
+					rb_rotate_left(other, root);
+					other = parent->rb_left;
+				}
+				other->rb_color = parent->rb_color;
+				parent->rb_color = RB_BLACK;
+				if (other->rb_left)
+					other->rb_left->rb_color = RB_BLACK;
+				rb_rotate_right(parent, root);
+				node = root->rb_node;
+				break;
+			}
+		}
+	}
+	if (node)
+		node->rb_color = RB_BLACK;
+}
+
+/*
+ * 有两个子节点时，用右子树中最小的节点替换被删除的节点
+ */
+void rb_erase(struct rb_node * node, struct rb_root * root)
+{
+	struct rb_node * child, * parent, * old, * left;
+	unsigned long color;
+
+	if (!node->rb_left)
+		child = node->rb_right;
+	else if (!node->rb_right)
+		child = node->rb_left;
+	else {
+		old = node;
+		node = node->rb_right;
+		while ((left = node->rb_left))
+			node = left;
+		child = node->rb_right;
+		parent = node->rb_parent;
+		color = node->rb_color;
+
+		if (child)
+			child->rb_parent = parent;
+		if (parent->rb_left == node)
+			parent->rb_left = child;
+		else
+			parent->rb_right = child;
+		if (node->rb_parent == old)
+			parent = node;
+
+		node->rb_parent = old->rb_parent;
+		node->rb_color = old->rb_color;
+		node->rb_right = old->rb_right;
+		node->rb_left = old->rb_left;
+
+		if (old->rb_parent) {
+			if (old->rb_parent->rb_left == old)
+				old->rb_parent->rb_left = node;
+			else
+				old->rb_parent->rb_right = node;
+		} else
+			root->rb_node = node;
+
+		old->rb_left->rb_parent = node;
+		if (old->rb_right)
+			old->rb_right->rb_parent = node;
+		goto color;
+	}
+
+	parent = node->rb_parent;
+	color = node->rb_color;
+
+	if (child)
+		child->rb_parent = parent;
+	if (parent) {
+		if (parent->rb_left == node)
+			parent->rb_left = child;
+		else
+			parent->rb_right = child;
+	} else
+		root->rb_node = child;
+
+color:
+	if (color == RB_BLACK)
+		rb_erase_color(child, parent, root);
+}
+
+struct rb_node * rb_first(struct rb_root * root)
+{
+	struct rb_node * n = root->rb_node;
+
+	if (!n)
+		return 0;
+	while (n->rb_left)
+		n = n->rb_left;
+	return n;
+}
+
+struct rb_node * rb_next(struct rb_node * node)
+{
+	if (node->rb_right) {
+		node = node->rb_right;
+		while (node->rb_left)
+			node = node->rb_left;
+		return node;
+	}
+	while (node->rb_parent && node == node->rb_parent->rb_right)
+		node = node->rb_parent;
+	return node->rb_parent;
+}
@@ -10,10 +10,13 @@
  * call functions (type getpid(), which just extracts a field from
  * current-task
  */
+#include <errno.h>
+
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/sys.h>
 #include <linux/fdreg.h>
+#include <linux/time.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/segment.h>
@@ -50,10 +53,25 @@ void show_stat(void)
 	for (i=0;i<NR_TASKS;i++)
 		if (task[i])
 			show_task(i,task[i]);
+	dcache_show();
+	dindex_show();
+	buffer_hash_show();
+	blk_show();
 }
 
 
-#define LATCH (1193180/HZ)
+
+/*
+ * 实时进程限流，每RT_PERIOD个滴答中实时进程最多运行RT_RUNTIME个滴答，
+ * 剩下的时间留给普通进程，防止失控的实时进程锁死系统
+ * 两者相等表示不限流，可以在Makefile.head中配置
+ */
+#ifndef RT_PERIOD
+#define RT_PERIOD	HZ
+#endif
+#ifndef RT_RUNTIME
+#define RT_RUNTIME	(RT_PERIOD*95/100)
+#endif
 
 /*
  * 没有找到调用的地方
@@ -75,10 +93,26 @@ static union task_union init_task = {INIT_TASK,};
 struct tss_struct *tss = &(init_task.task.tss);
 long volatile jiffies=0;
 long startup_time=0;
+#ifdef CONFIG_SMP
+struct task_struct * current_set[NR_CPUS] = {&(init_task.task), };
+#else
 struct task_struct * current = &(init_task.task);
+#endif
 struct task_struct * last_task_used_math = NULL;
 struct task_struct * task[NR_TASKS] = {&(init_task.task), };
 
+/*
+ * nr_rt_tasks 	系统中实时进程的个数，为0时不用扫描实时进程
+ * rt_seq 	实时进程排队的序号
+ * rt_time 	本周期内实时进程已经运行的滴答数
+ * rt_throttled 实时进程被限流，直到本周期结束
+ */
+int nr_rt_tasks = 0;
+static unsigned long rt_seq = 0;
+static long rt_time = 0;
+static long rt_period_start = 0;
+static int rt_throttled = 0;
+
 long user_stack [ PAGE_SIZE>>2 ] ;
 
 struct {
@@ -117,25 +151,79 @@ void math_state_restore()
  * information in task[0] is never used.
  */
 
-extern void switch_to_by_stack(long, long, long);
+extern void switch_to_by_stack(long, long, long, long, long);
+
+#ifdef CONFIG_SMP
+/*
+ * 负载均衡
+ * 本CPU上没有可运行的进程时调用，统计每个CPU上可运行但没有占用CPU的进程数，
+ * 从最多的CPU上迁移一个进程到本CPU
+ */
+static int steal_task(int cpu)
+{
+	int load[NR_CPUS] = {0,};
+	int i, busiest = -1, max = 0;
+	struct task_struct * p;
+
+	for (i = 1; i < NR_TASKS; i++) {
+		p = task[i];
+		if (p && p->state == TASK_RUNNING && !p->has_cpu)
+			load[p->processor]++;
+	}
+	for (i = 0; i < NR_CPUS; i++)
+		if (i != cpu && load[i] > max)
+			max = load[i], busiest = i;
+	if (busiest < 0)
+		return 0;
+	for (i = NR_TASKS-1; i > 0; i--) {
+		p = task[i];
+		if (p && p->processor == busiest &&
+		    p->state == TASK_RUNNING && !p->has_cpu) {
+			p->processor = cpu;
+			return 1;
+		}
+	}
+	return 0;
+}
+#endif
+
 void schedule(void)
 {
 	int i,next,c;
 	struct task_struct *pnext = &(init_task.task);
 	struct task_struct ** p;
-	int flag;
+#ifdef CONFIG_SMP
+	struct task_struct * prev = current;
+	int cpu = smp_processor_id();
+#endif
 
 	/* check alarm, wake up any interruptible tasks that have got a signal */
 	/* 从数组的组后开始遍历
 	 * 如果任务设置了alarm并且已经超时，设置SIGALRM信号，清除alarm
 	 *
 	 */
+	/*
+	 * 进程要睡眠了，把plug的块设备请求交给驱动程序
+	 */
+	if (blk_plugged)
+		blk_unplug();
+	next_timeout = 0;
 	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
 		if (*p) {
 			if ((*p)->alarm && (*p)->alarm < jiffies) {
 					(*p)->signal |= (1<<(SIGALRM-1));
 					(*p)->alarm = 0;
 			}
+			/*
+			 * nanosleep到期，唤醒进程，同时记录最早的到期时间
+			 */
+			if ((*p)->timeout && (*p)->timeout < jiffies) {
+				(*p)->timeout = 0;
+				if ((*p)->state == TASK_INTERRUPTIBLE)
+					(*p)->state = TASK_RUNNING;
+			} else if ((*p)->timeout &&
+			    (!next_timeout || (*p)->timeout < next_timeout))
+				next_timeout = (*p)->timeout;
 			/*
 			 * 如果有信号，并且进程处于可中断的睡眠状态
 			 * 将进程设置为运行状态
@@ -145,8 +233,62 @@ void schedule(void)
 			if (((*p)->signal & (_BLOCKABLE & ~(*p)->blocked)) &&
 			(*p)->state==TASK_INTERRUPTIBLE)
 				(*p)->state=TASK_RUNNING;
+#ifdef CONFIG_FAIR_SCHED
+			/*
+			 * 唤醒进程的地方只修改state，在这里统一加入运行队列
+			 */
+			fair_check_task(*p);
+#endif
 		}
+#ifdef CONFIG_FAIR_SCHED
+	fair_put_prev(current);
+#endif
+
+	/*
+	 * 实时进程总是先于普通进程运行，选择rt_priority最高的，
+	 * 相同优先级时选择rt_seq最小的，也就是最先排队的
+	 */
+	if (nr_rt_tasks && !rt_throttled) {
+		c = 0;
+		i = NR_TASKS;
+		p = &task[NR_TASKS];
+		while (--i) {
+			if (!*--p)
+				continue;
+			if ((*p)->policy == SCHED_OTHER || (*p)->state != TASK_RUNNING)
+				continue;
+#ifdef CONFIG_SMP
+			if ((*p)->processor != cpu || ((*p)->has_cpu && *p != prev))
+				continue;
+#endif
+			if ((*p)->rt_priority > c ||
+			    ((*p)->rt_priority == c && (*p)->rt_seq < pnext->rt_seq))
+				c = (*p)->rt_priority, pnext = *p, next = i;
+		}
+		if (c)
+			goto switch_tasks;
+	}
 
+#ifdef CONFIG_FAIR_SCHED
+	/*
+	 * 公平调度器直接取红黑树最左边的进程，没有则运行idle进程
+	 * 进程在task数组中的下标由LDT选择子得到
+	 */
+	pnext = fair_pick_next();
+	if (pnext) {
+		next = (pnext->tss.ldt - _LDT(0)) >> 4;
+#ifdef CONFIG_SMP
+		pnext->processor = cpu;
+#endif
+	} else {
+		next = 0;
+#ifdef CONFIG_SMP
+		pnext = cpu_data[cpu].idle;
+#else
+		pnext = task[0];
+#endif
+	}
+#else
 	/* 
 	 * this is the scheduler proper: 
 	 * 调度器
@@ -158,7 +300,12 @@ void schedule(void)
 		 * next和pnext都是目前的第一个进程
 		 */
 		next = 0;
+#ifdef CONFIG_SMP
+		pnext = cpu_data[cpu].idle;
+		cpu_data[cpu].nr_running = 0;
+#else
 		pnext = task[next];
+#endif
 		
 		i = NR_TASKS;
 		p = &task[NR_TASKS];
@@ -168,9 +315,29 @@ void schedule(void)
 		while (--i) {
 			if (!*--p)
 				continue;
+#ifdef CONFIG_SMP
+			/*
+			 * 只在本CPU的运行队列中选择，正在其他CPU上运行的进程不能选
+			 */
+			if ((*p)->processor != cpu || ((*p)->has_cpu && *p != prev))
+				continue;
+			if ((*p)->state == TASK_RUNNING)
+				cpu_data[cpu].nr_running++;
+#endif
+			/*
+			 * 实时进程在前面已经选择过，到这里说明被限流了，
+			 * 不参与按counter的选择，否则SCHED_RR和SCHED_FIFO的counter
+			 * 不会减少，限流不起作用
+			 */
+			if ((*p)->policy != SCHED_OTHER)
+				continue;
 			if ((*p)->state == TASK_RUNNING && (*p)->counter > c)
 				c = (*p)->counter, pnext = *p, next = i; 
 		}
+#ifdef CONFIG_SMP
+		if (c < 0 && steal_task(cpu))
+			continue;
+#endif
 		/*
 		 * 如果找到，退出循环进行任务切换
 		 */
@@ -184,11 +351,25 @@ void schedule(void)
 				(*p)->counter = ((*p)->counter >> 1) +
 						(*p)->priority;
 	}
+#endif
 
+switch_tasks:
 #ifdef CONFIG_SWITCH_TSS
 	switch_to(next);
+#elif defined(CONFIG_SMP)
+	/*
+	 * 切换时大内核锁仍由本CPU持有，递归深度就在各自的lock_depth中
+	 */
+	if (pnext != prev) {
+		prev->has_cpu = 0;
+		pnext->has_cpu = 1;
+		cpu_data[cpu].nr_switches++;
+	}
+	switch_to_by_stack((long)pnext, (long)(_LDT(next)), pnext->tss.cr3,
+		(long)cpu_data[cpu].tss, (long)&current_set[cpu]);
 #else
-	switch_to_by_stack((long)pnext, (long)(_LDT(next)), pnext->tss.cr3);
+	switch_to_by_stack((long)pnext, (long)(_LDT(next)), pnext->tss.cr3,
+		(long)tss, (long)&current);
 #endif
 }
 
@@ -303,6 +484,11 @@ repeat:
 
 void wake_up(struct task_struct **p)
 {
+	/*
+	 * select/poll的进程不在sleep_on的链中，单独登记
+	 */
+	if (p && nr_select_wait)
+		wake_up_select(p);
 	if (p && *p) {
 		(*p)->state = TASK_RUNNING;
 		/*
@@ -441,14 +627,43 @@ void add_timer(long jiffies, void (*fn)(void))
 	sti();
 }
 
+/*
+ * 本CPU上是否有比current优先级更高的实时进程可以运行
+ */
+static int rt_preempt(void)
+{
+	struct task_struct ** p;
+	long prio = (current->policy == SCHED_OTHER) ? 0 : current->rt_priority;
+
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
+		if (!*p || (*p)->policy == SCHED_OTHER)
+			continue;
+#ifdef CONFIG_SMP
+		if ((*p)->processor != smp_processor_id() || (*p)->has_cpu)
+			continue;
+#endif
+		if ((*p)->state == TASK_RUNNING && (*p)->rt_priority > prio)
+			return 1;
+	}
+	return 0;
+}
+
 void do_timer(long cpl)
 {
 	extern int beepcount;
 	extern void sysbeepstop(void);
 
-	if (beepcount)
-		if (!--beepcount)
+	/*
+	 * 蜂鸣器，定时器和软驱只在BSP的时钟中断中处理，
+	 * AP的Local APIC时钟中断只用于进程的时间片
+	 */
+	if (!smp_processor_id()) {
+		time_tick();
+		if (beepcount && !--beepcount)
 			sysbeepstop();
+		if (blk_plugged)
+			blk_unplug();
+	}
 
 	/*
 	 * 增加内核时间或用户时间计数
@@ -463,7 +678,7 @@ void do_timer(long cpl)
 	/*
 	 * 如果有定时器存在则处理定制器相关
 	 */
-	if (next_timer) {
+	if (!smp_processor_id() && next_timer) {
 		next_timer->jiffies--;
 		while (next_timer && next_timer->jiffies <= 0) {
 			void (*fn)(void);
@@ -475,13 +690,53 @@ void do_timer(long cpl)
 		}
 	}
 	
-	if (current_DOR & 0xf0)
+	if (!smp_processor_id() && (current_DOR & 0xf0))
 		do_floppy_timer();
 
+	/*
+	 * 有nanosleep到期的进程，尽快调度以唤醒它
+	 */
+	if (next_timeout && next_timeout < jiffies)
+		goto resched;
+
+	/*
+	 * 实时进程的时间片和限流
+	 * SCHED_FIFO没有时间片，SCHED_RR的时间片用完后排到同优先级的最后
+	 * 普通进程运行时如果有实时进程可以运行，则立即调度
+	 */
+	if (nr_rt_tasks) {
+		if (jiffies - rt_period_start >= RT_PERIOD) {
+			rt_period_start = jiffies;
+			rt_time = 0;
+			rt_throttled = 0;
+		}
+		if (current->policy != SCHED_OTHER) {
+			if (RT_RUNTIME < RT_PERIOD &&
+			    ++rt_time >= RT_RUNTIME * smp_num_cpus)
+				rt_throttled = 1;
+			if (current->policy == SCHED_RR && --current->counter <= 0) {
+				current->counter = RR_TIMESLICE;
+				current->rt_seq = ++rt_seq;
+				goto resched;
+			}
+			if (rt_throttled || rt_preempt())
+				goto resched;
+			return;
+		}
+		if (!rt_throttled && rt_preempt())
+			goto resched;
+	}
+
+#ifdef CONFIG_FAIR_SCHED
+	if (fair_tick(current))
+		goto resched;
+#endif
+
 	if ((--current->counter)>0) 
 		return;
 
 	current->counter=0;
+resched:
 	/*
 	 * 这句话很重要，也就是如果是在内核态不进行调度，内核否则就涉及一个
 	 * 概念叫内核抢占，因此我们知道，在linux内核程序被中断后，中断推出
@@ -536,11 +791,74 @@ int sys_getegid(void)
 
 int sys_nice(long increment)
 {
+#ifdef CONFIG_FAIR_SCHED
+	if (increment < 0 && !suser())
+		return -EPERM;
+	fair_set_nice(current, current->nice + increment);
+#endif
 	if (current->priority-increment>0)
 		current->priority -= increment;
 	return 0;
 }
 
+struct task_struct * find_task_by_pid(int pid)
+{
+	struct task_struct ** p;
+
+	if (!pid)
+		return current;
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p && (*p)->pid == pid)
+			return *p;
+	return NULL;
+}
+
+/*
+ * 设置进程的调度策略，设置实时策略需要超级用户权限
+ */
+int sys_sched_setscheduler(int pid, int policy, struct sched_param * param)
+{
+	struct task_struct * p;
+	int prio;
+
+	if (!param || pid < 0)
+		return -EINVAL;
+	prio = get_fs_long((unsigned long *) &param->sched_priority);
+	if (policy != SCHED_OTHER && policy != SCHED_FIFO && policy != SCHED_RR)
+		return -EINVAL;
+	if (policy == SCHED_OTHER ? prio != 0 :
+	    (prio < SCHED_RT_PRIO_MIN || prio > SCHED_RT_PRIO_MAX))
+		return -EINVAL;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
+	if (policy != SCHED_OTHER && !suser())
+		return -EPERM;
+	if (p != current && current->euid != p->euid && !suser())
+		return -EPERM;
+	if (p->policy == SCHED_OTHER && policy != SCHED_OTHER)
+		nr_rt_tasks++;
+	else if (p->policy != SCHED_OTHER && policy == SCHED_OTHER)
+		nr_rt_tasks--;
+	p->policy = policy;
+	p->rt_priority = prio;
+	p->rt_seq = ++rt_seq;
+	if (policy == SCHED_RR)
+		p->counter = RR_TIMESLICE;
+	schedule();
+	return 0;
+}
+
+int sys_sched_getscheduler(int pid)
+{
+	struct task_struct * p;
+
+	if (pid < 0)
+		return -EINVAL;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
+	return p->policy;
+}
+
 void sched_init(void)
 {
 	int i;
@@ -555,6 +873,11 @@ void sched_init(void)
 	 */
 	set_tss_desc(gdt+FIRST_TSS_ENTRY, &(init_task.task.tss));
 	set_ldt_desc(gdt+FIRST_LDT_ENTRY, &(init_task.task.ldt));
+#ifdef CONFIG_SMP
+	cpu_data[0].idle = &(init_task.task);
+	cpu_data[0].tss = &(init_task.task.tss);
+	init_task.task.has_cpu = 1;
+#endif
 
 #ifdef CONFIG_SWITCH_TSS
 	printk("task switch use TSS\n");
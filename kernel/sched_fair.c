@@ -0,0 +1,250 @@
+/*
+ *  linux/kernel/sched_fair.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 公平调度器，使用make FAIR=1编译
+ *
+ * 每个进程记录虚拟运行时间vruntime，运行一个滴答增加NICE_0_LOAD/weight，
+ * weight由nice值决定，nice每差1，得到的CPU时间大约差10%
+ * 可运行的进程按vruntime排序放在红黑树中，每次选择最左边也就是
+ * vruntime最小的进程，不再需要counter全部为0时重新计算所有进程
+ *
+ * 正在运行的进程不在树中，但是计入nr_running和load，
+ * on_rq表示进程计入了运行队列，in_tree表示进程在红黑树中
+ *
+ * 时间片由可运行进程的个数决定，SCHED_LATENCY内每个进程都至少运行一次，
+ * 进程多时每个进程至少运行SCHED_MIN_GRAN个滴答
+ *
+ * SMP下所有CPU共用一个运行队列，由大内核锁保护
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+
+#define NICE_0_LOAD	1024
+
+/*
+ * 单位都是滴答
+ */
+#define SCHED_LATENCY	(HZ/5)
+#define SCHED_MIN_GRAN	1
+#define SCHED_WAKEUP_GRAN	1
+
+/*
+ * nice从-20到19对应的权重，相邻两项的比值约为1.25
+ */
+static const long prio_to_weight[40] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
+
+#define task_weight(p)	(prio_to_weight[(p)->nice + 20])
+
+/*
+ * vruntime会回绕，只比较差值
+ */
+#define vruntime_before(a, b)	((long)((a) - (b)) < 0)
+
+static struct {
+	struct rb_root root;
+	struct rb_node * leftmost;
+	unsigned long min_vruntime;
+	long nr_running;
+	long load;
+} fair_rq = { RB_ROOT, NULL, 0, 0, 0 };
+
+static void enqueue_tree(struct task_struct * p)
+{
+	struct rb_node ** link = &fair_rq.root.rb_node;
+	struct rb_node * parent = NULL;
+	int leftmost = 1;
+
+	while (*link) {
+		parent = *link;
+		if (vruntime_before(p->vruntime,
+		    rb_entry(parent, struct task_struct, run_node)->vruntime))
+			link = &parent->rb_left;
+		else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+	if (leftmost)
+		fair_rq.leftmost = &p->run_node;
+	rb_link_node(&p->run_node, parent, link);
+	rb_insert_color(&p->run_node, &fair_rq.root);
+	p->in_tree = 1;
+}
+
+static void dequeue_tree(struct task_struct * p)
+{
+	if (fair_rq.leftmost == &p->run_node)
+		fair_rq.leftmost = rb_next(&p->run_node);
+	rb_erase(&p->run_node, &fair_rq.root);
+	p->in_tree = 0;
+}
+
+static inline struct task_struct * first_task(void)
+{
+	if (!fair_rq.leftmost)
+		return NULL;
+	return rb_entry(fair_rq.leftmost, struct task_struct, run_node);
+}
+
+/*
+ * min_vruntime只增不减，取正在运行的进程和树中最左边进程的较小值
+ */
+static void update_min_vruntime(struct task_struct * curr)
+{
+	struct task_struct * first = first_task();
+	unsigned long vruntime = fair_rq.min_vruntime;
+
+	if (curr && curr->on_rq)
+		vruntime = curr->vruntime;
+	if (first && (!curr || !curr->on_rq ||
+	    vruntime_before(first->vruntime, vruntime)))
+		vruntime = first->vruntime;
+	if (vruntime_before(fair_rq.min_vruntime, vruntime))
+		fair_rq.min_vruntime = vruntime;
+}
+
+/*
+ * 进程变为可运行，睡眠过的进程最多得到半个SCHED_LATENCY的补偿，
+ * 防止睡眠很久的进程醒来后长时间独占CPU
+ */
+static void fair_activate(struct task_struct * p)
+{
+	unsigned long vruntime;
+
+	vruntime = fair_rq.min_vruntime - SCHED_LATENCY * NICE_0_LOAD / 2;
+	if (vruntime_before(p->vruntime, vruntime))
+		p->vruntime = vruntime;
+	p->on_rq = 1;
+	fair_rq.nr_running++;
+	fair_rq.load += task_weight(p);
+	enqueue_tree(p);
+}
+
+static void fair_deactivate(struct task_struct * p)
+{
+	if (p->in_tree)
+		dequeue_tree(p);
+	p->on_rq = 0;
+	fair_rq.nr_running--;
+	fair_rq.load -= task_weight(p);
+}
+
+/*
+ * schedule中对每个进程调用，使运行队列和进程状态保持一致，
+ * 正在运行的进程不在树中，由fair_put_prev处理
+ */
+void fair_check_task(struct task_struct * p)
+{
+	int runnable = (p->state == TASK_RUNNING && p->policy == SCHED_OTHER);
+
+	if (runnable && !p->on_rq)
+		fair_activate(p);
+	else if (!runnable && p->in_tree)
+		fair_deactivate(p);
+}
+
+/*
+ * 切换前处理当前进程，仍可运行则放回树中，否则移出运行队列
+ */
+void fair_put_prev(struct task_struct * prev)
+{
+	if (!prev->on_rq)
+		return;
+	if (prev->state == TASK_RUNNING && prev->policy == SCHED_OTHER) {
+		if (!prev->in_tree)
+			enqueue_tree(prev);
+	} else
+		fair_deactivate(prev);
+}
+
+/*
+ * 选择vruntime最小的进程，并根据权重分配时间片放到counter中
+ */
+struct task_struct * fair_pick_next(void)
+{
+	struct task_struct * p = first_task();
+	long period, slice;
+
+	if (!p)
+		return NULL;
+	dequeue_tree(p);
+	period = SCHED_LATENCY;
+	if (fair_rq.nr_running * SCHED_MIN_GRAN > period)
+		period = fair_rq.nr_running * SCHED_MIN_GRAN;
+	slice = period * task_weight(p) / fair_rq.load;
+	if (slice < SCHED_MIN_GRAN)
+		slice = SCHED_MIN_GRAN;
+	p->counter = slice;
+	update_min_vruntime(p);
+	return p;
+}
+
+/*
+ * 唤醒进程的地方只修改state，下次schedule时才加入红黑树，
+ * 时钟中断可能打断正在修改红黑树的schedule，所以这里不加入，
+ * 只检查新唤醒的进程按fair_activate补偿后的vruntime是否应该抢占当前进程
+ */
+static int wakeup_preempt(struct task_struct * curr)
+{
+	struct task_struct ** p;
+	unsigned long vruntime, floor;
+
+	floor = fair_rq.min_vruntime - SCHED_LATENCY * NICE_0_LOAD / 2;
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
+		if (!*p || *p == curr || (*p)->on_rq ||
+		    (*p)->state != TASK_RUNNING || (*p)->policy != SCHED_OTHER)
+			continue;
+		if (!curr->on_rq)
+			return 1;
+		vruntime = (*p)->vruntime;
+		if (vruntime_before(vruntime, floor))
+			vruntime = floor;
+		if (vruntime_before(vruntime + SCHED_WAKEUP_GRAN * NICE_0_LOAD,
+		    curr->vruntime))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * 时钟中断中调用，累加当前进程的vruntime，
+ * 返回1表示需要调度：CPU空闲而有进程在等待，
+ * 或者等待的或者新唤醒的进程的vruntime比当前进程小了SCHED_WAKEUP_GRAN以上
+ */
+int fair_tick(struct task_struct * curr)
+{
+	struct task_struct * first = first_task();
+
+	if (!curr->on_rq)
+		return first != NULL || wakeup_preempt(curr);
+	curr->vruntime += NICE_0_LOAD * NICE_0_LOAD / task_weight(curr);
+	update_min_vruntime(curr);
+	if (first && vruntime_before(first->vruntime +
+	    SCHED_WAKEUP_GRAN * NICE_0_LOAD, curr->vruntime))
+		return 1;
+	return wakeup_preempt(curr);
+}
+
+void fair_set_nice(struct task_struct * p, long nice)
+{
+	if (nice < -20)
+		nice = -20;
+	if (nice > 19)
+		nice = 19;
+	if (p->on_rq)
+		fair_rq.load += prio_to_weight[nice + 20] - task_weight(p);
+	p->nice = nice;
+}
@@ -0,0 +1,524 @@
+/*
+ *  linux/kernel/smp.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * smp.c 多处理器的启动和相关支持，只有make SMP=1时才会编译
+ *
+ * 1. 通过Intel MP规范的浮动指针结构找到MP配置表，获取处理器和IO-APIC
+ * 2. 将Local APIC和IO-APIC映射到线性地址0xFFC00000，页表在内核映像中，
+ *    在第一次fork之前设置到swapper_pg_dir中，因此所有进程共享
+ * 3. BSP通过INIT-SIPI-SIPI启动AP，AP从trampoline.s进入start_secondary
+ * 4. 外部中断仍然由8259通过BSP的LINT0(virtual wire)送入，IO-APIC的
+ *    所有中断输入都屏蔽，AP只处理Local APIC时钟中断和IPI
+ * 5. 大内核锁和TLB刷新
+ */
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/head.h>
+#include <linux/time.h>
+#include <asm/system.h>
+#include <asm/io.h>
+
+/*
+ * MP浮动指针结构，16字节对齐
+ */
+#define SMP_MAGIC_IDENT	(('_'<<24)|('P'<<16)|('M'<<8)|'_')
+
+struct mpf_intel {
+	char signature[4];		/* "_MP_" */
+	unsigned long physptr;		/* MP配置表的物理地址 */
+	unsigned char length;		/* 以16字节为单位，为1 */
+	unsigned char specification;
+	unsigned char checksum;
+	unsigned char feature1;		/* 不为0表示使用默认配置 */
+	unsigned char feature2;
+	unsigned char feature3;
+	unsigned char feature4;
+	unsigned char feature5;
+};
+
+struct mpc_table {
+	char signature[4];		/* "PCMP" */
+	unsigned short length;
+	char spec;
+	char checksum;
+	char oem[8];
+	char productid[12];
+	unsigned long oemptr;
+	unsigned short oemsize;
+	unsigned short oemcount;
+	unsigned long lapic;		/* Local APIC的物理地址 */
+	unsigned long reserved;
+};
+
+#define MP_PROCESSOR	0
+#define MP_BUS		1
+#define MP_IOAPIC	2
+#define MP_INTSRC	3
+#define MP_LINTSRC	4
+
+struct mpc_config_processor {
+	unsigned char type;
+	unsigned char apicid;
+	unsigned char apicver;
+	unsigned char cpuflag;
+	unsigned long cpufeature;
+	unsigned long featureflag;
+	unsigned long reserved[2];
+};
+
+#define CPU_ENABLED		1
+#define CPU_BOOTPROCESSOR	2
+
+struct mpc_config_ioapic {
+	unsigned char type;
+	unsigned char apicid;
+	unsigned char apicver;
+	unsigned char flags;
+	unsigned long apicaddr;
+};
+
+struct cpuinfo cpu_data[NR_CPUS];
+unsigned char apic_to_cpu[256];
+int smp_num_cpus = 1;
+volatile unsigned long smp_invalidate_needed = 0;
+
+/*
+ * 大内核锁
+ * kernel_flag 		锁本身
+ * kernel_lock_owner 	持有锁的CPU
+ * 递归深度放在持有锁的进程的lock_depth中，进程切换时不需要保存和恢复
+ */
+static volatile unsigned long kernel_flag = 0;
+static volatile int kernel_lock_owner = NO_PROC_ID;
+
+/*
+ * ap_stack_top 	trampoline.s中AP使用的栈，BSP启动每个AP前设置
+ * smp_commenced 	BSP完成初始化后置位，AP开始调度
+ */
+unsigned long ap_stack_top = 0;
+static volatile int smp_commenced = 0;
+
+static int mp_nr_cpus = 0;
+static int mp_apic_ids[NR_CPUS];
+static unsigned long apic_phys = APIC_DEFAULT_PHYS_BASE;
+static unsigned long io_apic_phys = 0;
+static unsigned long apic_timer_count = 0;
+
+static struct tss_struct cpu_tss[NR_CPUS];
+
+/*
+ * 映射APIC的页表，放在页目录的第1023项
+ */
+static unsigned long apic_pg_table[1024] __attribute__((aligned(4096)));
+
+extern char trampoline[];
+extern void apic_timer_interrupt(void);
+extern void invalidate_interrupt(void);
+extern void spurious_interrupt(void);
+
+static inline void local_flush_tlb(void)
+{
+	__asm__ __volatile__("movl %%cr3,%%eax\n\tmovl %%eax,%%cr3":::"ax");
+}
+
+static int mpf_checksum(unsigned char * p, int len)
+{
+	int sum = 0;
+
+	while (len--)
+		sum += *p++;
+	return sum & 0xff;
+}
+
+static struct mpf_intel * smp_scan_config(unsigned long base, unsigned long length)
+{
+	unsigned long * bp = (unsigned long *) base;
+	struct mpf_intel * mpf;
+
+	while (length > 0) {
+		mpf = (struct mpf_intel *) bp;
+		if (*bp == SMP_MAGIC_IDENT && mpf->length == 1 &&
+		    !mpf_checksum((unsigned char *) bp, 16))
+			return mpf;
+		bp += 4;
+		length -= 16;
+	}
+	return NULL;
+}
+
+static void smp_read_mpc(struct mpc_table * mpc)
+{
+	unsigned char * mpt = (unsigned char *)(mpc + 1);
+	int count = mpc->length - sizeof(struct mpc_table);
+
+	if (memcmp(mpc->signature, "PCMP", 4) ||
+	    mpf_checksum((unsigned char *) mpc, mpc->length)) {
+		printk("SMP: bad mptable\n");
+		return;
+	}
+	apic_phys = mpc->lapic;
+	while (count > 0) {
+		switch (*mpt) {
+		case MP_PROCESSOR: {
+			struct mpc_config_processor * m =
+				(struct mpc_config_processor *) mpt;
+
+			if ((m->cpuflag & CPU_ENABLED) && mp_nr_cpus < NR_CPUS)
+				mp_apic_ids[mp_nr_cpus++] = m->apicid;
+			mpt += sizeof(*m);
+			count -= sizeof(*m);
+			break;
+		}
+		case MP_IOAPIC: {
+			struct mpc_config_ioapic * m =
+				(struct mpc_config_ioapic *) mpt;
+
+			if (!io_apic_phys && (m->flags & 1))
+				io_apic_phys = m->apicaddr;
+			mpt += sizeof(*m);
+			count -= sizeof(*m);
+			break;
+		}
+		case MP_BUS:
+		case MP_INTSRC:
+		case MP_LINTSRC:
+			mpt += 8;
+			count -= 8;
+			break;
+		default:
+			printk("SMP: unknown mptable entry %d\n", *mpt);
+			return;
+		}
+	}
+}
+
+/*
+ * 最后一个1KB的基本内存和BIOS的ROM区
+ * 内核从物理地址0开始，BIOS数据区已经被覆盖，不能从0x40E获取EBDA
+ */
+static struct mpf_intel * smp_find_config(void)
+{
+	struct mpf_intel * mpf;
+
+	if ((mpf = smp_scan_config(0x9FC00, 0x400)))
+		return mpf;
+	return smp_scan_config(0xF0000, 0x10000);
+}
+
+static void smp_map_apic(void)
+{
+	int i;
+
+	for (i = 0; i < 1024; i++)
+		apic_pg_table[i] = 0;
+	/* present, rw, PWT, PCD */
+	apic_pg_table[0] = apic_phys | 0x1b;
+	if (io_apic_phys)
+		apic_pg_table[1] = io_apic_phys | 0x1b;
+	swapper_pg_dir[1023] = (unsigned long) apic_pg_table | 3;
+	local_flush_tlb();
+}
+
+static void setup_local_apic(int bsp)
+{
+	unsigned long v;
+
+	v = apic_read(APIC_SPIV);
+	v &= ~0xff;
+	v |= APIC_SPIV_ENABLE | SPURIOUS_APIC_VECTOR;
+	apic_write(APIC_SPIV, v);
+	apic_write(APIC_TASKPRI, 0);
+	/*
+	 * 8259的中断只送给BSP
+	 */
+	if (bsp)
+		apic_write(APIC_LVT0, APIC_DM_EXTINT);
+	else
+		apic_write(APIC_LVT0, APIC_DM_EXTINT | APIC_LVT_MASKED);
+	apic_write(APIC_LVT1, APIC_DM_NMI | (bsp ? 0 : APIC_LVT_MASKED));
+	apic_write(APIC_LVTERR, APIC_LVT_MASKED);
+	apic_write(APIC_ESR, 0);
+}
+
+/*
+ * 屏蔽IO-APIC的所有中断输入，设备中断仍然走8259
+ */
+static void setup_io_apic(void)
+{
+	int i, nr;
+
+	if (!io_apic_phys)
+		return;
+	nr = ((io_apic_read(IO_APIC_VERSION) >> 16) & 0xff) + 1;
+	for (i = 0; i < nr; i++) {
+		io_apic_write(IO_APIC_REDTBL(i) + 1, 0);
+		io_apic_write(IO_APIC_REDTBL(i), APIC_LVT_MASKED);
+	}
+}
+
+/*
+ * 用PIT测量Local APIC时钟在一个滴答(1000/HZ ms)内的计数
+ */
+static void calibrate_apic_timer(void)
+{
+	apic_write(APIC_TDCR, APIC_TDR_DIV_16);
+	apic_write(APIC_LVTT, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+	apic_write(APIC_TMICT, 0xffffffff);
+	pit_mdelay(1000/HZ);
+	apic_timer_count = 0xffffffff - apic_read(APIC_TMCCT);
+	apic_write(APIC_TMICT, 0);
+	printk("SMP: APIC timer %d counts per tick\n", apic_timer_count);
+}
+
+static void setup_apic_timer(void)
+{
+	apic_write(APIC_TDCR, APIC_TDR_DIV_16);
+	apic_write(APIC_LVTT, APIC_LVT_TIMER_PERIODIC | APIC_TIMER_VECTOR);
+	apic_write(APIC_TMICT, apic_timer_count);
+}
+
+static void send_ipi(int apicid, unsigned long cmd)
+{
+	while (apic_read(APIC_ICR) & APIC_ICR_BUSY)
+		;
+	apic_write(APIC_ICR2, apicid << 24);
+	apic_write(APIC_ICR, cmd);
+}
+
+/*
+ * 在mem_init之前调用，此后才能使用current
+ */
+void smp_init(void)
+{
+	struct mpf_intel * mpf;
+	int bsp_id, i;
+
+	if (FIRST_CPU_TSS_ENTRY != 132)
+		panic("FIRST_CPU_TSS in system_call.s is wrong");
+	smp_map_apic();
+	mpf = smp_find_config();
+	if (mpf && mpf->feature1) {
+		/* 默认配置，两个处理器 */
+		mp_apic_ids[0] = 0;
+		mp_apic_ids[1] = 1;
+		mp_nr_cpus = 2;
+		io_apic_phys = IO_APIC_DEFAULT_PHYS_BASE;
+	} else if (mpf && mpf->physptr < 16*1024*1024)
+		smp_read_mpc((struct mpc_table *) mpf->physptr);
+	smp_map_apic();
+
+	bsp_id = apic_read(APIC_ID) >> 24;
+	cpu_data[0].apic_id = bsp_id;
+	cpu_data[0].online = 1;
+	apic_to_cpu[bsp_id] = 0;
+	/*
+	 * BSP总是CPU0，其余的处理器按照MP表中的顺序编号
+	 */
+	for (i = 0; i < mp_nr_cpus; i++)
+		if (mp_apic_ids[i] == bsp_id)
+			break;
+	if (i < mp_nr_cpus) {
+		mp_apic_ids[i] = mp_apic_ids[0];
+		mp_apic_ids[0] = bsp_id;
+	}
+	printk("SMP: %d processors found, BSP APIC %d\n", mp_nr_cpus, bsp_id);
+	if (mp_nr_cpus < 2)
+		return;
+
+	set_intr_gate(APIC_TIMER_VECTOR, &apic_timer_interrupt);
+	set_intr_gate(INVALIDATE_TLB_VECTOR, &invalidate_interrupt);
+	set_intr_gate(SPURIOUS_APIC_VECTOR, &spurious_interrupt);
+	setup_local_apic(1);
+	setup_io_apic();
+}
+
+/*
+ * AP从trampoline.s进入，此时已经使用内核的段和swapper_pg_dir
+ */
+void start_secondary(void)
+{
+	int cpu = apic_to_cpu[apic_read(APIC_ID) >> 24];
+
+	setup_local_apic(0);
+	set_tss_desc(gdt+FIRST_CPU_TSS_ENTRY+cpu, cpu_data[cpu].tss);
+	__asm__("ltr %%ax"::"a" ((FIRST_CPU_TSS_ENTRY+cpu)<<3));
+	lldt(0);
+	sysenter_setup(cpu_data[cpu].tss);
+	__asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
+	__asm__("fninit");
+	current_set[cpu] = cpu_data[cpu].idle;
+	setup_apic_timer();
+	cpu_data[cpu].online = 1;
+	while (!smp_commenced)
+		__asm__("rep ; nop");
+	sti();
+	/*
+	 * AP的idle进程，没有进程可运行时停在hlt等待时钟中断
+	 */
+	for (;;) {
+		lock_kernel();
+		schedule();
+		unlock_kernel();
+		__asm__("sti ; hlt");
+	}
+}
+
+/*
+ * 在sched_init之后调用，需要get_free_page分配idle进程
+ */
+void smp_boot_cpus(void)
+{
+	int cpu, timeout;
+	unsigned long page;
+	struct task_struct * idle;
+
+	if (mp_nr_cpus < 2)
+		return;
+	calibrate_apic_timer();
+	for (cpu = 1; cpu < mp_nr_cpus; cpu++) {
+		if (!(page = get_free_page()))
+			break;
+		idle = (struct task_struct *) page;
+		*idle = *task[0];
+		idle->state = TASK_RUNNING;
+		idle->counter = 0;
+		idle->processor = cpu;
+		idle->has_cpu = 1;
+		idle->lock_depth = 0;
+		cpu_tss[cpu].ss0 = 0x10;
+		cpu_tss[cpu].esp0 = page + PAGE_SIZE;
+		cpu_tss[cpu].trace_bitmap = 0x80000000;
+		cpu_data[cpu].apic_id = mp_apic_ids[cpu];
+		cpu_data[cpu].idle = idle;
+		cpu_data[cpu].tss = &cpu_tss[cpu];
+		apic_to_cpu[mp_apic_ids[cpu]] = cpu;
+		ap_stack_top = page + PAGE_SIZE;
+
+		send_ipi(mp_apic_ids[cpu], APIC_INT_LEVELTRIG | APIC_INT_ASSERT | APIC_DM_INIT);
+		pit_mdelay(10);
+		send_ipi(mp_apic_ids[cpu], APIC_INT_LEVELTRIG | APIC_DM_INIT);
+		send_ipi(mp_apic_ids[cpu], APIC_DM_STARTUP | ((unsigned long) trampoline >> 12));
+		pit_mdelay(1);
+		if (!cpu_data[cpu].online)
+			send_ipi(mp_apic_ids[cpu], APIC_DM_STARTUP | ((unsigned long) trampoline >> 12));
+		for (timeout = 0; timeout < 100 && !cpu_data[cpu].online; timeout++)
+			pit_mdelay(10);
+		if (cpu_data[cpu].online) {
+			smp_num_cpus++;
+			printk("SMP: CPU%d (APIC %d) online\n", cpu, mp_apic_ids[cpu]);
+		} else
+			printk("SMP: CPU%d (APIC %d) not responding\n", cpu, mp_apic_ids[cpu]);
+	}
+}
+
+void smp_commence(void)
+{
+	smp_commenced = 1;
+}
+
+/*
+ * fork时为新进程选择一个可运行进程最少的CPU
+ */
+int smp_pick_cpu(void)
+{
+	int load[NR_CPUS] = {0,};
+	int i, cpu = 0;
+
+	for (i = 1; i < NR_TASKS; i++)
+		if (task[i] && task[i]->state == TASK_RUNNING)
+			load[task[i]->processor]++;
+	for (i = 1; i < NR_CPUS; i++)
+		if (cpu_data[i].online && load[i] < load[cpu])
+			cpu = i;
+	return cpu;
+}
+
+static inline void smp_check_invalidate(int cpu)
+{
+	if (smp_invalidate_needed & (1 << cpu)) {
+		__asm__ __volatile__("lock ; btrl %1,%0"
+			:"+m" (smp_invalidate_needed):"r" (cpu));
+		local_flush_tlb();
+	}
+}
+
+/*
+ * 刷新所有CPU的TLB，调用者持有大内核锁
+ * 其他CPU可能在等待大内核锁时关闭了中断，因此在自旋时也要检查刷新请求
+ */
+void smp_flush_tlb(void)
+{
+	int cpu, i;
+	unsigned long mask = 0;
+
+	local_flush_tlb();
+	if (smp_num_cpus < 2 || !smp_commenced)
+		return;
+	cpu = smp_processor_id();
+	for (i = 0; i < NR_CPUS; i++)
+		if (i != cpu && cpu_data[i].online)
+			mask |= 1 << i;
+	smp_invalidate_needed = mask;
+	send_ipi(0, APIC_DEST_ALLBUT | INVALIDATE_TLB_VECTOR);
+	while (smp_invalidate_needed)
+		__asm__("rep ; nop");
+}
+
+void smp_invalidate_rcv(void)
+{
+	smp_check_invalidate(smp_processor_id());
+	apic_write(APIC_EOI, 0);
+}
+
+void lock_kernel(void)
+{
+	int cpu = smp_processor_id();
+	unsigned long old;
+
+	if (kernel_lock_owner == cpu) {
+		current->lock_depth++;
+		return;
+	}
+	for (;;) {
+		old = 1;
+		__asm__ __volatile__("xchgl %0,%1"
+			:"+r" (old),"+m" (kernel_flag)::"memory");
+		if (!old)
+			break;
+		while (kernel_flag) {
+			smp_check_invalidate(cpu);
+			__asm__("rep ; nop");
+		}
+	}
+	kernel_lock_owner = cpu;
+	current->lock_depth = 1;
+}
+
+void unlock_kernel(void)
+{
+	struct task_struct * p = current;
+
+	if (--p->lock_depth > 0)
+		return;
+	p->lock_depth = 0;
+	kernel_lock_owner = NO_PROC_ID;
+	__asm__ __volatile__("":::"memory");
+	kernel_flag = 0;
+}
+
+/*
+ * fork出的新进程第一次返回用户态时调用，不管递归深度直接释放
+ */
+void release_kernel_lock(void)
+{
+	current->lock_depth = 0;
+	kernel_lock_owner = NO_PROC_ID;
+	__asm__ __volatile__("":::"memory");
+	kernel_flag = 0;
+}
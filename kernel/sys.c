@@ -9,6 +9,7 @@
 #include <linux/sched.h>
 #include <linux/tty.h>
 #include <linux/kernel.h>
+#include <linux/time.h>
 #include <asm/segment.h>
 #include <sys/times.h>
 #include <sys/utsname.h>
@@ -179,6 +180,8 @@ int sys_stime(long * tptr)
 	if (!suser())
 		return -EPERM;
 	startup_time = get_fs_long((unsigned long *)tptr) - jiffies/HZ;
+	startup_nsec = 0;
+	update_vtime();
 	return 0;
 }
 
@@ -234,11 +237,6 @@ int sys_getpgrp(void)
 	return current->pgrp;
 }
 
-int sys_select( unsigned long *buffer )
-{
-	return -ERROR;
-}
-
 int sys_setsid(void)
 {
 	if (current->leader && !suser())
@@ -264,12 +262,11 @@ int sys_uname(struct utsname * name)
 	static struct utsname thisname = {
 		"linux .0","nodename","release ","version ","machine "
 	};
-	int i;
 
 	if (!name) return -ERROR;
 	verify_area(name,sizeof *name);
-	for(i=0;i<sizeof *name;i++)
-		put_fs_byte(((char *) &thisname)[i],i+(char *) name);
+	if (copy_to_user(name, &thisname, sizeof *name))
+		return -EFAULT;
 	return 0;
 }
 
@@ -294,16 +291,6 @@ int sys_getrusage(int who, struct rusage *ru)
 	return -ERROR;
 }
 
-int sys_gettimeofday(struct timeval *tv, struct timezone *tz)
-{
-	return -ERROR;
-}
-
-int sys_settimeofday(struct timeval *tv, struct timezone *tz)
-{
-	return -ERROR;
-}
-
 int sys_umask(int mask)
 {
 	int old = current->umask;
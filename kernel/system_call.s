@@ -60,7 +60,34 @@ sa_mask = 4
 sa_flags = 8
 sa_restorer = 12
 
-nr_system_calls = 86
+nr_system_calls = 101
+
+# 系统调用入口页的用户地址，和include/linux/vtime.h中的VSYSCALL_ADDR一致
+VSYSCALL_ADDR = 0xBF001000
+
+#
+# SMP时current是每个CPU一个，和smp.h中的smp_processor_id一样通过TR找到本CPU，
+# BSP的TR是_TSS(0)，AP的是FIRST_CPU_TSS_ENTRY+cpu，不读Local APIC
+# 进入内核的路径需要获取大内核锁，lock_kernel/unlock_kernel会破坏eax,ecx,edx
+#
+.ifdef CONFIG_SMP
+APIC_EOI_REG	= 0x3FC000B0
+FIRST_CPU_TSS	= 132		# FIRST_CPU_TSS_ENTRY = 4+2*NR_TASKS
+
+.macro GET_CURRENT reg
+	str \reg
+	andl $0xffff,\reg
+	shrl $3,\reg
+	subl $FIRST_CPU_TSS,\reg
+	jae 1f
+	xorl \reg,\reg
+1:	movl current_set(,\reg,4),\reg
+.endm
+.else
+.macro GET_CURRENT reg
+	movl current,\reg
+.endm
+.endif
 
 /*
  * Ok, I get parallel printer interrupts while using the floppy for some
@@ -70,6 +97,11 @@ nr_system_calls = 86
 .globl hd_interrupt,floppy_interrupt,parallel_interrupt
 .globl device_not_available, coprocessor_error
 .globl switch_to_by_stack, first_return_from_kernel
+.globl sysenter_entry, vsyscall_int80, vsyscall_int80_end
+.globl vsyscall_sysenter, vsyscall_sysenter_end
+.ifdef CONFIG_SMP
+.globl apic_timer_interrupt, invalidate_interrupt, spurious_interrupt
+.endif
 
 .align 4
 bad_sys_call:
@@ -95,15 +127,23 @@ system_call:
 	mov %dx,%es                     # 设置附加段为内核数据段， 代码段在执行INT指令时已经设置了
 	movl $0x17,%edx		            # fs points to local data space
 	mov %dx,%fs                     # 设置FS为用户段选择子
+.ifdef CONFIG_SMP
+	pushl %eax
+	call lock_kernel                # 获取大内核锁，在ret_from_sys_call中释放
+	popl %eax
+.endif
+	cmpl $0,syscall_trace           # 打开了系统调用统计或跟踪
+	jne traced_sys_call
 	call *sys_call_table(,%eax,4)   # call地址sys_call_table + eax * 4, 即调用sys_fork程序，此时会将下一条指令的EIP入栈
 	pushl %eax                      # 返回值存放在eax中
-	movl current,%eax               # 取当前进程指针存放在eax中
+sys_call_ret:
+	GET_CURRENT %eax                # 取当前进程指针存放在eax中
 	cmpl $0,state(%eax)		        # state 
 	jne reschedule                  # 如果state不等于0则运行重新调度程序
 	cmpl $0,counter(%eax)		    # counter，如果在运行状态但是时间片用完了也执行调用程序
 	je reschedule
 ret_from_sys_call:
-	movl current,%eax		        # task[0] cannot have signals
+	GET_CURRENT %eax		        # task[0] cannot have signals
 	cmpl task,%eax                  # 判断是不是任务0，如果是跳到标号3处运行，任务0不执行信号处理
 	je 3f
 	cmpw $0x0f,CS(%esp)		        # was old code segment supervisor ? 如果是调用者是内核程序也不进行信号处理
@@ -122,15 +162,102 @@ ret_from_sys_call:
 	pushl %ecx						# 信号值
 	call do_signal                  # 调用信号处理函数do_signal(ecx)为参数
 	popl %eax						# 弹出信号值
-3:	popl %eax						# 恢复寄存器并恢复到用户空间执行
+3:
+.ifdef CONFIG_SMP
+	call unlock_kernel              # 释放大内核锁
+.endif
+	popl %eax						# 恢复寄存器并恢复到用户空间执行
 	popl %ebx
 	popl %ecx
 	popl %edx
 	pop %fs
 	pop %es
 	pop %ds
+	cmpl $SYSENTER_RETURN,(%esp)    # 从sysenter进入并且没有信号处理，使用sysexit返回
+	je sysexit_return
 	iret
 
+#
+# 打开了统计或跟踪时的系统调用路径，见kernel/systrace.c
+# 参数在栈上，所以在调用前后都要保持和普通路径一样的栈
+#
+.align 4
+traced_sys_call:
+	pushl %eax                      # 系统调用号
+	pushl 4(%esp)                   # 第一个参数ebx
+	pushl %eax
+	call syscall_trace_enter
+	addl $8,%esp
+	popl %eax
+	call *sys_call_table(,%eax,4)
+	pushl %eax                      # 返回值
+	pushl %eax
+	call syscall_trace_exit
+	addl $4,%esp
+	jmp sys_call_ret
+
+#
+# sysexit从edx取用户eip，从ecx取用户esp，用户存根会恢复ecx和edx
+# sysexit不恢复IF，因此先关中断恢复eflags，sti的下一条指令执行完才开中断
+#
+sysexit_return:
+	popl %edx                       # eip
+	addl $4,%esp                    # cs
+	andl $0xfffffdff,(%esp)         # 清除IF
+	popfl                           # eflags
+	popl %ecx                       # esp
+	addl $4,%esp                    # ss
+	sti
+	sysexit
+
+#
+# sysenter入口，此时中断是关闭的，cs和ss是GDT_SYSENTER中基地址为0的平坦段
+# 切换到内核段后构造和int 0x80一样的栈帧，然后使用system_call处理
+# 用户存根把用户esp放在ebp中，ebx,ecx,edx仍然是系统调用的参数
+#
+.align 4
+sysenter_entry:
+	ljmp $0x08,$1f                  # 切换到基地址为0xC0000000的内核代码段
+1:	lss (%esp),%esp                 # SYSENTER_ESP指向TSS的esp0，后面是ss0
+	pushl $0x17                     # ss
+	pushl %ebp                      # esp
+	pushfl                          # eflags
+	orl $0x200,(%esp)               # 返回用户态时打开中断
+	pushl $0x0f                     # cs
+	pushl $SYSENTER_RETURN          # eip
+	sti
+	jmp system_call
+
+#
+# 用户态的系统调用存根，启动时复制到系统调用入口页，运行在VSYSCALL_ADDR处
+# 调用者按照int 0x80的约定在eax,ebx,ecx,edx中传递参数，返回值在eax中
+#
+vsyscall_int80:
+	int $0x80
+	ret
+vsyscall_int80_end:
+
+#
+# sysexit返回时cs和ss是GDT_SYSENTER中的平坦段，切换回LDT中的段
+#
+vsyscall_sysenter:
+	pushl %ecx
+	pushl %edx
+	pushl %ebp
+	movl %esp,%ebp
+	sysenter
+sysenter_ret:
+	ljmp $0x0f,$VSYSCALL_ADDR+(2f-vsyscall_sysenter)
+2:	pushl $0x17
+	popl %ss
+	popl %ebp
+	popl %edx
+	popl %ecx
+	ret
+vsyscall_sysenter_end:
+
+SYSENTER_RETURN = VSYSCALL_ADDR+(sysenter_ret-vsyscall_sysenter)
+
 .align 4
 coprocessor_error:
 	push %ds
@@ -145,6 +272,9 @@ coprocessor_error:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	pushl $ret_from_sys_call
 	jmp math_error
 
@@ -169,8 +299,9 @@ switch_to_by_stack:
 	#
 	# 以上代码就是常说的保存现场
 	#
-	movl 8(%ebp),%ebx               # *(ebp + 8)存放的是pnext, ebp = [EIP, CS, pnext, ldt, cr]
-	cmpl %ebx,current               # 判断要切换的任务和当前任务是不是一样
+	movl 8(%ebp),%ebx               # *(ebp + 8)存放的是pnext, ebp = [EIP, CS, pnext, ldt, cr3, tss, &current]
+	movl 24(%ebp),%edx              # &current，SMP时为本CPU的current_set项
+	cmpl %ebx,(%edx)                # 判断要切换的任务和当前任务是不是一样
 	je 1f                           # 如果一样跳转到1处
 
 	# switch_to PCB
@@ -181,9 +312,9 @@ switch_to_by_stack:
 	#
 	cli
 	movl %ebx,%eax                  # pnext赋值给ebx
-	xchgl %eax,current              # 交换current和eax，current目前是pnext了
+	xchgl %eax,(%edx)               # 交换current和eax，current目前是pnext了
 	# rewrite TSS pointer
-	movl tss,%ecx                   # 当前tss段地址
+	movl 20(%ebp),%ecx              # 当前CPU的tss段地址
 	addl $4096,%ebx                 # ebx是pnext（task struct）的顶端，也就是栈顶
 	movl %ebx,4(%ecx)               # 4表示esp0的偏移，设置tss的内核态指针为task的顶端
 	# switch_to system core stack
@@ -230,6 +361,19 @@ switch_to_by_stack:
 
 .align 4
 first_return_from_kernel: 
+.ifdef CONFIG_SMP
+	push %ds                        # 此时ds是用户态的，调用C函数前切换到内核数据段
+	pushl %eax
+	pushl %ecx
+	pushl %edx
+	movl $0x10,%eax
+	mov %ax,%ds
+	call release_kernel_lock        # 新进程直接返回用户态，释放大内核锁
+	popl %edx
+	popl %ecx
+	popl %eax
+	pop %ds
+.endif
 	iret
 	
 .align 4
@@ -246,6 +390,9 @@ device_not_available:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	pushl $ret_from_sys_call
 	clts				            # clear TS so that we can use math
 	movl %cr0,%eax
@@ -274,6 +421,9 @@ timer_interrupt:
 	mov %ax,%es                     # es设置为内核数据段
 	movl $0x17,%eax                 #
 	mov %ax,%fs                     # fs设置为用户数据断
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	incl jiffies                    # 增加jiffies计数
 	movb $0x20,%al		            # EOI to interrupt controller #1，结束中断指令
 	outb %al,$0x20                  #
@@ -318,6 +468,9 @@ hd_interrupt:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	movb $0x20,%al
 	outb %al,$0xA0		# EOI to interrupt controller #1
 	jmp 1f			    # give port chance to breathe
@@ -329,6 +482,9 @@ hd_interrupt:
 	movl $unexpected_hd_interrupt,%edx
 1:	outb %al,$0x20
 	call *%edx		    # "interesting" way of handling intr.
+.ifdef CONFIG_SMP
+	call unlock_kernel
+.endif
 	pop %fs
 	pop %es
 	pop %ds
@@ -349,6 +505,9 @@ floppy_interrupt:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+.ifdef CONFIG_SMP
+	call lock_kernel
+.endif
 	movb $0x20,%al
 	outb %al,$0x20		# EOI to interrupt controller #1
 	xorl %eax,%eax
@@ -357,6 +516,9 @@ floppy_interrupt:
 	jne 1f
 	movl $unexpected_floppy_interrupt,%eax
 1:	call *%eax		    # "interesting" way of handling intr.
+.ifdef CONFIG_SMP
+	call unlock_kernel
+.endif
 	pop %fs
 	pop %es
 	pop %ds
@@ -372,3 +534,56 @@ parallel_interrupt:
 	popl %eax
 	iret
 	
+
+.ifdef CONFIG_SMP
+#
+# AP的Local APIC时钟中断，和timer_interrupt一样，只是不增加jiffies
+#
+.align 4
+apic_timer_interrupt:
+	push %ds
+	push %es
+	push %fs
+	pushl %edx
+	pushl %ecx
+	pushl %ebx
+	pushl %eax
+	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	movl $0x17,%eax
+	mov %ax,%fs
+	call lock_kernel
+	movl $0,APIC_EOI_REG            # EOI to local APIC
+	movl CS(%esp),%eax
+	andl $3,%eax
+	pushl %eax
+	call do_timer
+	addl $4,%esp
+	jmp ret_from_sys_call
+
+#
+# 其他CPU修改了页表，刷新本CPU的TLB
+#
+.align 4
+invalidate_interrupt:
+	pushl %eax
+	pushl %ecx
+	pushl %edx
+	push %ds
+	push %es
+	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	call smp_invalidate_rcv
+	pop %es
+	pop %ds
+	popl %edx
+	popl %ecx
+	popl %eax
+	iret
+
+.align 4
+spurious_interrupt:
+	iret
+.endif
@@ -0,0 +1,184 @@
+/*
+ *  linux/kernel/systrace.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 系统调用统计和跟踪，见include/linux/systrace.h
+ *
+ * syscall_trace不为0时system_call走traced_sys_call，
+ * 进入和退出时分别调用syscall_trace_enter和syscall_trace_exit
+ * 都在大内核锁中调用，不需要另外加锁
+ */
+#include <errno.h>
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/time.h>
+#include <linux/systrace.h>
+#include <asm/segment.h>
+#include <asm/cpuid.h>
+
+/*
+ * 1 	打开了统计
+ * 2 	有进程在跟踪
+ */
+int syscall_trace = 0;
+
+static int stats_pid = 0;
+static int nr_traced = 0;
+static struct systrace_stat systrace_stats[SYSTRACE_NR];
+
+/*
+ * 环形缓冲区，满了以后覆盖最老的记录
+ */
+static struct systrace_record ring[SYSTRACE_RING];
+static unsigned long ring_head = 0, ring_tail = 0;
+
+static inline unsigned long systrace_clock(void)
+{
+	unsigned long t;
+
+	if (!tsc_present)
+		return jiffies;
+	rdtscl(t);
+	return t;
+}
+
+static void update_trace(void)
+{
+	syscall_trace = (syscall_trace & 1) | (nr_traced ? 2 : 0);
+}
+
+static void add_record(long nr, int type, long val, unsigned long time)
+{
+	struct systrace_record * r;
+
+	if (ring_head - ring_tail >= SYSTRACE_RING)
+		ring_tail++;
+	r = ring + (ring_head++ % SYSTRACE_RING);
+	r->pid = current->pid;
+	r->nr = nr;
+	r->type = type;
+	r->val = val;
+	r->time = time;
+}
+
+void syscall_trace_enter(long nr, long arg)
+{
+	current->sys_nr = nr;
+	current->sys_start = systrace_clock();
+	if (current->trace)
+		add_record(nr, SYSTRACE_ENTER, arg, current->sys_start);
+}
+
+/*
+ * sys_nr为-1表示进入系统调用时还没有打开统计和跟踪，不计入
+ */
+void syscall_trace_exit(long ret)
+{
+	struct systrace_stat * s;
+	unsigned long now, delta;
+	long nr = current->sys_nr;
+	int i;
+
+	if (nr < 0 || nr >= SYSTRACE_NR)
+		return;
+	current->sys_nr = -1;
+	now = systrace_clock();
+	if (current->trace)
+		add_record(nr, SYSTRACE_EXIT, ret, now);
+	if (!(syscall_trace & 1) || (stats_pid && current->pid != stats_pid))
+		return;
+	delta = now - current->sys_start;
+	s = systrace_stats + nr;
+	s->count++;
+	s->time += delta;
+	for (i = 0 ; i < SYSTRACE_HIST-1 && (delta >> (i+1)) ; i++)
+		;
+	s->hist[i]++;
+}
+
+/*
+ * 正在系统调用中的进程没有记录开始时间
+ */
+static void reset_inflight(void)
+{
+	int i;
+
+	for (i = 0 ; i < NR_TASKS ; i++)
+		if (task[i])
+			task[i]->sys_nr = -1;
+}
+
+void systrace_untrace(struct task_struct * p)
+{
+	if (!p->trace)
+		return;
+	p->trace = 0;
+	nr_traced--;
+	update_trace();
+}
+
+int sys_systrace(int cmd, long arg, char * buf)
+{
+	struct task_struct * p;
+	int n;
+
+	if (!suser())
+		return -EPERM;
+	switch (cmd) {
+		case SYSTRACE_STATS_ON:
+			if (!(syscall_trace & 1))
+				reset_inflight();
+			stats_pid = arg;
+			syscall_trace |= 1;
+			return 0;
+		case SYSTRACE_STATS_OFF:
+			syscall_trace &= ~1;
+			return 0;
+		case SYSTRACE_TRACE_ON:
+			if (!(p = find_task_by_pid(arg)))
+				return -ESRCH;
+			if (!syscall_trace)
+				reset_inflight();
+			if (!p->trace) {
+				p->trace = 1;
+				nr_traced++;
+				update_trace();
+			}
+			return 0;
+		case SYSTRACE_TRACE_OFF:
+			if (!(p = find_task_by_pid(arg)))
+				return -ESRCH;
+			systrace_untrace(p);
+			return 0;
+		case SYSTRACE_GET_STATS:
+			n = sizeof (systrace_stats);
+			if (arg < n)
+				n = arg;
+			if (n <= 0)
+				return -EINVAL;
+			verify_area(buf, n);
+			if (copy_to_user(buf, systrace_stats, n))
+				return -EFAULT;
+			return n;
+		case SYSTRACE_GET_TRACE:
+			for (n = 0 ; n < arg && ring_tail != ring_head ; n++) {
+				verify_area(buf, sizeof (struct systrace_record));
+				if (copy_to_user(buf, ring + (ring_tail % SYSTRACE_RING),
+				    sizeof (struct systrace_record)))
+					return n?n:-EFAULT;
+				ring_tail++;
+				buf += sizeof (struct systrace_record);
+			}
+			return n;
+		case SYSTRACE_RESET:
+			memset(systrace_stats, 0, sizeof (systrace_stats));
+			ring_head = ring_tail = 0;
+			return 0;
+	}
+	return -EINVAL;
+}
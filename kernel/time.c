@@ -0,0 +1,336 @@
+/*
+ *  linux/kernel/time.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 高精度时间
+ *
+ * jiffies只有一个滴答(10ms)的精度，两次时钟中断之间经过的时间由时钟源提供：
+ * 1. CPU支持TSC时，启动时使用PIT通道2校准TSC的频率，
+ *    每次时钟中断记录TSC，读时间时用TSC的差值换算成纳秒
+ * 2. 不支持TSC时，锁存PIT通道0的当前计数值，计算本滴答内已经过去的时间
+ *
+ * 单调时间 = jiffies + 本滴答内的偏移
+ * 墙上时间 = 单调时间 + 启动时间(startup_time, startup_nsec)
+ *
+ * SMP下读时间的系统调用和时钟中断都持有大内核锁，jiffies和tsc_at_tick是一致的，
+ * 但是假设各个CPU的TSC是同步的
+ *
+ * 同样的数据也写到共享时间页中，用户态使用seq保证读到一致的数据
+ */
+#include <errno.h>
+#include <time.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/time.h>
+#include <linux/vtime.h>
+#include <linux/mm.h>
+#include <asm/system.h>
+#include <asm/io.h>
+#include <asm/segment.h>
+#include <asm/cpuid.h>
+#include <sys/times.h>
+
+#define CALIBRATE_MS	50
+
+/*
+ * startup_nsec 	启动时间中不足一秒的部分，由settimeofday设置
+ * next_timeout 	最早到期的nanosleep，时钟中断中检查，0表示没有
+ * tsc_mult/tsc_shift 	TSC差值换算为纳秒: ns = (delta * tsc_mult) >> tsc_shift
+ * tsc_at_tick 	最近一次时钟中断时的TSC
+ */
+long startup_nsec = 0;
+long next_timeout = 0;
+int tsc_present = 0;
+unsigned long tsc_khz = 0;
+static unsigned long tsc_mult, tsc_shift;
+static unsigned long tsc_at_tick;
+static struct timezone sys_tz = { 0, DST_NONE };
+
+/*
+ * 共享时间页，在内核映像中，mem_map为USED，fork和exit时不会复制和释放
+ */
+unsigned long time_page[PAGE_SIZE/4] __attribute__((aligned(4096)));
+#define vtime	((struct vtime_data *) time_page)
+
+/*
+ * 使用PIT的通道2延时，不依赖时钟中断，可以在开中断之前使用
+ * 通道2为方式0，计数到0时0x61端口的bit5置位，一次最多计数54ms
+ */
+void pit_mdelay(int ms)
+{
+	int n;
+
+	while (ms > 0) {
+		n = (ms > CALIBRATE_MS) ? CALIBRATE_MS : ms;
+		outb((inb(0x61) & ~0x02) | 0x01, 0x61);
+		outb(0xb0, 0x43);
+		outb((CLOCK_TICK_RATE/1000*n) & 0xff, 0x42);
+		outb((CLOCK_TICK_RATE/1000*n) >> 8, 0x42);
+		while (!(inb(0x61) & 0x20))
+			;
+		ms -= n;
+	}
+}
+
+/*
+ * 启动时调用，还没有开中断
+ * tsc_shift尽量大以保证精度，同时tsc_mult不能超过32位
+ */
+void clocksource_init(void)
+{
+	unsigned long t1, t2, hi, lo;
+	unsigned long long n;
+	int k;
+
+	if (!has_cpuid() || !(cpuid_edx(1) & X86_FEATURE_TSC)) {
+		printk("clocksource: pit\n");
+		return;
+	}
+	rdtscl(t1);
+	pit_mdelay(CALIBRATE_MS);
+	rdtscl(t2);
+	tsc_khz = (t2 - t1) / CALIBRATE_MS;
+	if (!tsc_khz) {
+		printk("clocksource: pit\n");
+		return;
+	}
+	for (k = 0 ; (tsc_khz << k) <= 1000000 ; k++)
+		;
+	tsc_shift = 32 - k;
+	n = 1000000ULL << tsc_shift;
+	hi = n >> 32;
+	lo = n;
+	__asm__("divl %2":"=a" (tsc_mult),"=d" (hi):"r" (tsc_khz),"0" (lo),"1" (hi));
+	rdtscl(tsc_at_tick);
+	tsc_present = 1;
+	update_vtime();
+	printk("clocksource: tsc %d kHz\n", tsc_khz);
+}
+
+/*
+ * 更新共享时间页，关中断防止和时钟中断同时写，SMP下写者都持有大内核锁
+ */
+void update_vtime(void)
+{
+	unsigned long flags;
+
+	local_irq_disable(flags);
+	vtime->seq++;
+	__asm__ __volatile__("":::"memory");
+	vtime->jiffies = jiffies;
+	vtime->hz = HZ;
+	vtime->tick_nsec = NSEC_PER_TICK;
+	vtime->startup_time = startup_time;
+	vtime->startup_nsec = startup_nsec;
+	vtime->tsc_present = tsc_present;
+	vtime->tsc_at_tick = tsc_at_tick;
+	vtime->tsc_mult = tsc_mult;
+	vtime->tsc_shift = tsc_shift;
+	__asm__ __volatile__("":::"memory");
+	vtime->seq++;
+	local_irq_restore(flags);
+}
+
+/*
+ * 在BSP的时钟中断中调用
+ */
+void time_tick(void)
+{
+	if (tsc_present)
+		rdtscl(tsc_at_tick);
+	update_vtime();
+}
+
+static unsigned long tsc_to_ns(unsigned long delta)
+{
+	return ((unsigned long long) delta * tsc_mult) >> tsc_shift;
+}
+
+/*
+ * 上次时钟中断以来经过的纳秒数，需要关中断调用
+ * PIT计数到0后如果中断还没有处理（8259的IRR中IRQ0置位），
+ * 计数值已经重新开始，需要加上一个滴答
+ */
+static unsigned long gettimeoffset(void)
+{
+	unsigned long now, count, ns;
+
+	if (tsc_present) {
+		rdtscl(now);
+		ns = tsc_to_ns(now - tsc_at_tick);
+	} else {
+		outb_p(0x00, 0x43);
+		count = inb_p(0x40);
+		count |= inb_p(0x40) << 8;
+		count = LATCH - count;
+		outb_p(0x0a, 0x20);
+		if ((inb_p(0x20) & 1) && count < LATCH/2)
+			count += LATCH;
+		ns = count * 838 + count * 96 / 1000;
+	}
+	if (ns >= NSEC_PER_SEC)
+		ns = NSEC_PER_SEC - 1;
+	return ns;
+}
+
+void do_monotonic(struct timespec * ts)
+{
+	unsigned long flags, ns;
+	long j;
+
+	local_irq_disable(flags);
+	j = jiffies;
+	ns = gettimeoffset();
+	local_irq_restore(flags);
+	ns += (j % HZ) * NSEC_PER_TICK;
+	ts->tv_sec = j / HZ;
+	while (ns >= NSEC_PER_SEC) {
+		ns -= NSEC_PER_SEC;
+		ts->tv_sec++;
+	}
+	ts->tv_nsec = ns;
+}
+
+void do_realtime(struct timespec * ts)
+{
+	do_monotonic(ts);
+	ts->tv_sec += startup_time;
+	ts->tv_nsec += startup_nsec;
+	if (ts->tv_nsec >= NSEC_PER_SEC) {
+		ts->tv_nsec -= NSEC_PER_SEC;
+		ts->tv_sec++;
+	}
+}
+
+int sys_gettimeofday(struct timeval * tv, struct timezone * tz)
+{
+	struct timespec ts;
+
+	if (tv) {
+		do_realtime(&ts);
+		verify_area(tv, sizeof *tv);
+		put_fs_long(ts.tv_sec, (unsigned long *) &tv->tv_sec);
+		put_fs_long(ts.tv_nsec / 1000, (unsigned long *) &tv->tv_usec);
+	}
+	if (tz) {
+		verify_area(tz, sizeof *tz);
+		put_fs_long(sys_tz.tz_minuteswest, (unsigned long *) &tz->tz_minuteswest);
+		put_fs_long(sys_tz.tz_dsttime, (unsigned long *) &tz->tz_dsttime);
+	}
+	return 0;
+}
+
+/*
+ * 调整启动时间，使墙上时间等于tv，单调时间不受影响
+ */
+int sys_settimeofday(struct timeval * tv, struct timezone * tz)
+{
+	struct timespec ts;
+	long sec, usec, nsec;
+
+	if (!suser())
+		return -EPERM;
+	if (tv) {
+		sec = get_fs_long((unsigned long *) &tv->tv_sec);
+		usec = get_fs_long((unsigned long *) &tv->tv_usec);
+		if (usec < 0 || usec >= 1000000)
+			return -EINVAL;
+		do_monotonic(&ts);
+		nsec = usec * 1000 - ts.tv_nsec;
+		sec -= ts.tv_sec;
+		if (nsec < 0) {
+			nsec += NSEC_PER_SEC;
+			sec--;
+		}
+		startup_time = sec;
+		startup_nsec = nsec;
+		update_vtime();
+	}
+	if (tz) {
+		sys_tz.tz_minuteswest = get_fs_long((unsigned long *) &tz->tz_minuteswest);
+		sys_tz.tz_dsttime = get_fs_long((unsigned long *) &tz->tz_dsttime);
+	}
+	return 0;
+}
+
+int sys_clock_gettime(int which, struct timespec * tp)
+{
+	struct timespec ts;
+
+	if (which == CLOCK_REALTIME)
+		do_realtime(&ts);
+	else if (which == CLOCK_MONOTONIC)
+		do_monotonic(&ts);
+	else
+		return -EINVAL;
+	if (!tp)
+		return -EFAULT;
+	verify_area(tp, sizeof *tp);
+	put_fs_long(ts.tv_sec, (unsigned long *) &tp->tv_sec);
+	put_fs_long(ts.tv_nsec, (unsigned long *) &tp->tv_nsec);
+	return 0;
+}
+
+/*
+ * 忙等，只用于实时进程的短延时
+ */
+static void tsc_ndelay(unsigned long ns)
+{
+	unsigned long start, now;
+
+	rdtscl(start);
+	do {
+		rdtscl(now);
+	} while (tsc_to_ns(now - start) < ns);
+}
+
+/*
+ * 睡眠的滴答数向上取整，当前滴答已经过去了一部分，所以到期时间是jiffies+n，
+ * schedule中timeout < jiffies时才唤醒，保证至少睡眠请求的时间
+ * 实时进程2ms以下的睡眠使用TSC忙等，精度不受滴答的限制
+ */
+int sys_nanosleep(struct timespec * rqtp, struct timespec * rmtp)
+{
+	long sec, nsec, n;
+
+	if (!rqtp)
+		return -EFAULT;
+	sec = get_fs_long((unsigned long *) &rqtp->tv_sec);
+	nsec = get_fs_long((unsigned long *) &rqtp->tv_nsec);
+	if (sec < 0 || nsec < 0 || nsec >= NSEC_PER_SEC)
+		return -EINVAL;
+	if (!sec && nsec <= 2000000 && tsc_present &&
+	    current->policy != SCHED_OTHER) {
+		tsc_ndelay(nsec);
+		return 0;
+	}
+	if (sec > 0x7fffffff / HZ - 1)
+		sec = 0x7fffffff / HZ - 1;
+	n = sec * HZ + (nsec + NSEC_PER_TICK - 1) / NSEC_PER_TICK;
+	if (!n)
+		return 0;
+	current->timeout = jiffies + n;
+	if (!next_timeout || current->timeout < next_timeout)
+		next_timeout = current->timeout;
+	current->state = TASK_INTERRUPTIBLE;
+	schedule();
+	if (!current->timeout)
+		return 0;
+	/*
+	 * 被信号唤醒，返回剩余的时间
+	 */
+	n = current->timeout - jiffies;
+	current->timeout = 0;
+	if (rmtp) {
+		if (n < 0)
+			n = 0;
+		verify_area(rmtp, sizeof *rmtp);
+		put_fs_long(n / HZ, (unsigned long *) &rmtp->tv_sec);
+		put_fs_long((n % HZ) * NSEC_PER_TICK, (unsigned long *) &rmtp->tv_nsec);
+	}
+	return -EINTR;
+}
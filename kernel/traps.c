@@ -110,8 +110,34 @@ void do_double_fault(long esp, long error_code)
 	die("double fault",esp,error_code);
 }
 
+/*
+ * 异常表由链接器收集，__start___ex_table和__stop___ex_table由ld自动生成
+ */
+extern struct exception_table_entry __start___ex_table[];
+extern struct exception_table_entry __stop___ex_table[];
+
+unsigned long search_exception_table(unsigned long addr)
+{
+	struct exception_table_entry * p;
+
+	for (p = __start___ex_table ; p < __stop___ex_table ; p++)
+		if (p->insn == addr)
+			return p->fixup;
+	return 0;
+}
+
+/*
+ * 内核态复制用户数据时出错，跳到修复代码，由copy_xx_user返回错误
+ */
 void do_general_protection(long esp, long error_code)
 {
+	unsigned long fixup;
+
+	if (!(((long *) esp)[1] & 3) &&
+	    (fixup = search_exception_table(((long *) esp)[0]))) {
+		((long *) esp)[0] = fixup;
+		return;
+	}
 	die("general protection",esp,error_code);
 }
 
@@ -0,0 +1,98 @@
+/*
+ *  linux/kernel/vsyscall.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 快速系统调用(SYSENTER/SYSEXIT)
+ *
+ * 系统调用入口页在exec时映射到每个进程的VSYSCALL_ADDR处，
+ * 启动时根据CPU是否支持SEP复制vsyscall_sysenter或者vsyscall_int80到入口页，
+ * 用户程序调用VSYSCALL_ADDR即可，不用关心CPU是否支持sysenter
+ *
+ * sysenter/sysexit使用的段都是基地址为0的平坦段，而内核段的基地址是0xC0000000，
+ * 因此入口地址和栈地址都要加上0xC0000000，进入内核后立即切换到内核的段，
+ * 返回用户态后用户存根再切换回LDT中的段，见system_call.s
+ *
+ * SYSENTER_ESP指向TSS的esp0，进程切换时不用修改MSR，
+ * 使用TSS切换进程时每个进程有自己的TSS，不支持sysenter
+ */
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/head.h>
+#include <asm/cpuid.h>
+
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
+
+#define KERNEL_BASE		0xC0000000
+
+extern struct tss_struct * tss;
+extern void sysenter_entry(void);
+extern char vsyscall_int80[], vsyscall_int80_end[];
+extern char vsyscall_sysenter[], vsyscall_sysenter_end[];
+
+/*
+ * 系统调用入口页，在内核映像中，mem_map为USED，fork和exit时不会复制和释放
+ */
+unsigned long vsyscall_page[PAGE_SIZE/4] __attribute__((aligned(4096)));
+int sysenter_enabled = 0;
+
+/*
+ * 设置本CPU的SYSENTER MSR，每个CPU都要调用
+ */
+void sysenter_setup(struct tss_struct * tss)
+{
+	if (!sysenter_enabled)
+		return;
+	wrmsr(MSR_SYSENTER_CS, GDT_SYSENTER<<3, 0);
+	wrmsr(MSR_SYSENTER_ESP, KERNEL_BASE + (unsigned long) &tss->esp0, 0);
+	wrmsr(MSR_SYSENTER_EIP, KERNEL_BASE + (unsigned long) sysenter_entry, 0);
+}
+
+/*
+ * 在BSP上调用一次
+ * Pentium Pro的早期型号报告支持SEP，但是实际上不支持
+ */
+void vsyscall_init(void)
+{
+	unsigned long eax, edx;
+
+#ifndef CONFIG_SWITCH_TSS
+	if (has_cpuid()) {
+		cpuid(1, &eax, &edx);
+		if ((edx & X86_FEATURE_SEP) && !(((eax >> 8) & 0xf) == 6 &&
+		    ((eax >> 4) & 0xf) < 3 && (eax & 0xf) < 3))
+			sysenter_enabled = 1;
+	}
+#endif
+	if (!sysenter_enabled) {
+		memcpy(vsyscall_page, vsyscall_int80,
+			vsyscall_int80_end - vsyscall_int80);
+		printk("vsyscall: int 0x80\n");
+		return;
+	}
+	/*
+	 * 内核代码段，内核数据段，用户代码段(3GB)，用户数据段(3GB)
+	 */
+	gdt[GDT_SYSENTER].a = 0x0000ffff;
+	gdt[GDT_SYSENTER].b = 0x00cf9a00;
+	gdt[GDT_SYSENTER+1].a = 0x0000ffff;
+	gdt[GDT_SYSENTER+1].b = 0x00cf9200;
+	gdt[GDT_SYSENTER+2].a = 0x0000ffff;
+	gdt[GDT_SYSENTER+2].b = 0x00cbfa00;
+	gdt[GDT_SYSENTER+3].a = 0x0000ffff;
+	gdt[GDT_SYSENTER+3].b = 0x00cbf200;
+	memcpy(vsyscall_page, vsyscall_sysenter,
+		vsyscall_sysenter_end - vsyscall_sysenter);
+#ifdef CONFIG_SMP
+	sysenter_setup(cpu_data[0].tss);
+#else
+	sysenter_setup(tss);
+#endif
+	printk("vsyscall: sysenter\n");
+}
@@ -0,0 +1,10 @@
+/*
+ *  linux/lib/bdflush.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+_syscall2(int,bdflush,int,func,long,data)
@@ -0,0 +1,64 @@
+/*
+ *  linux/lib/clock_gettime.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <time.h>
+#include <linux/vtime.h>
+
+/*
+ * 优先读取共享时间页，不进入内核
+ * 内核更新时seq为奇数，读完后seq变化说明读的过程中内核更新了，需要重读
+ * CPU没有TSC时无法计算滴答内的偏移，使用系统调用
+ */
+static int vtime_gettime(int which, struct timespec * tp)
+{
+	struct vtime_data * vt = (struct vtime_data *) VTIME_ADDR;
+	unsigned long seq, now, ns;
+	long j, sec, nsec;
+
+	do {
+		seq = vt->seq;
+		__asm__ __volatile__("":::"memory");
+		if (!vt->tsc_present || !vt->hz)
+			return -1;
+		__asm__ __volatile__("rdtsc":"=a" (now)::"dx");
+		ns = ((unsigned long long) (now - vt->tsc_at_tick) *
+			vt->tsc_mult) >> vt->tsc_shift;
+		j = vt->jiffies;
+		sec = (which == CLOCK_REALTIME) ? vt->startup_time : 0;
+		nsec = (which == CLOCK_REALTIME) ? vt->startup_nsec : 0;
+		sec += j / vt->hz;
+		nsec += (j % vt->hz) * vt->tick_nsec;
+		__asm__ __volatile__("":::"memory");
+	} while ((seq & 1) || seq != vt->seq);
+	if (ns >= 1000000000)
+		ns = 999999999;
+	nsec += ns;
+	while (nsec >= 1000000000) {
+		nsec -= 1000000000;
+		sec++;
+	}
+	tp->tv_sec = sec;
+	tp->tv_nsec = nsec;
+	return 0;
+}
+
+int clock_gettime(clockid_t which, struct timespec * tp)
+{
+	long __res;
+
+	if ((which == CLOCK_REALTIME || which == CLOCK_MONOTONIC) &&
+	    !vtime_gettime(which, tp))
+		return 0;
+	__asm__ volatile (__SYSCALL_INSN
+		: "=a" (__res)
+		: "0" (__NR_clock_gettime),"b" ((long)(which)),"c" ((long)(tp)));
+	if (__res >= 0)
+		return (int) __res;
+	errno = -__res;
+	return -1;
+}
@@ -0,0 +1,11 @@
+/*
+ *  linux/lib/iostat.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <linux/iostat.h>
+
+_syscall3(int,iostat,int,cmd,char *,buf,int,size)
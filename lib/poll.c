@@ -0,0 +1,11 @@
+/*
+ *  linux/lib/poll.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <poll.h>
+
+_syscall3(int,poll,struct pollfd *,fds,unsigned int,nfds,int,timeout)
@@ -0,0 +1,39 @@
+/*
+ *  linux/lib/pread.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/uio.h>
+
+/*
+ * 系统调用最多3个参数，buf和count放在一个iovec中传给内核
+ */
+static int pread_pwrite(int nr, int fildes, const char * buf, off_t count, off_t offset)
+{
+	struct iovec iov;
+	long __res;
+
+	iov.iov_base = (char *) buf;
+	iov.iov_len = count;
+	__asm__ volatile (__SYSCALL_INSN
+		: "=a" (__res)
+		: "0" (nr),"b" (fildes),"c" (&iov),"d" (offset)
+		: "memory");
+	if (__res >= 0)
+		return __res;
+	errno = -__res;
+	return -1;
+}
+
+int pread(int fildes, char * buf, off_t count, off_t offset)
+{
+	return pread_pwrite(__NR_pread, fildes, buf, count, offset);
+}
+
+int pwrite(int fildes, const char * buf, off_t count, off_t offset)
+{
+	return pread_pwrite(__NR_pwrite, fildes, buf, count, offset);
+}
@@ -0,0 +1,32 @@
+/*
+ *  linux/lib/select.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+/*
+ * 系统调用最多3个参数，select的参数放在数组中传给内核
+ */
+int select(int n, fd_set * readfds, fd_set * writefds,
+	fd_set * exceptfds, struct timeval * timeout)
+{
+	long buffer[5];
+	long __res;
+
+	buffer[0] = n;
+	buffer[1] = (long) readfds;
+	buffer[2] = (long) writefds;
+	buffer[3] = (long) exceptfds;
+	buffer[4] = (long) timeout;
+	__asm__ volatile (__SYSCALL_INSN
+		: "=a" (__res)
+		: "0" (__NR_select),"b" (buffer)
+		: "memory");
+	if (__res >= 0)
+		return __res;
+	errno = -__res;
+	return -1;
+}
@@ -0,0 +1,31 @@
+/*
+ *  linux/lib/sendfile.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/sendfile.h>
+
+/*
+ * 系统调用最多3个参数，sendfile的参数放在数组中传给内核
+ */
+int sendfile(int out_fd, int in_fd, off_t * offset, size_t count)
+{
+	long buffer[4];
+	long __res;
+
+	buffer[0] = out_fd;
+	buffer[1] = in_fd;
+	buffer[2] = (long) offset;
+	buffer[3] = count;
+	__asm__ volatile (__SYSCALL_INSN
+		: "=a" (__res)
+		: "0" (__NR_sendfile),"b" (buffer)
+		: "memory");
+	if (__res >= 0)
+		return __res;
+	errno = -__res;
+	return -1;
+}
@@ -0,0 +1,11 @@
+/*
+ *  linux/lib/statfs.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/vfs.h>
+
+_syscall2(int,statfs,const char *,path,struct statfs *,buf)
@@ -0,0 +1,11 @@
+/*
+ *  linux/lib/systrace.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <linux/systrace.h>
+
+_syscall3(int,systrace,int,cmd,long,arg,char *,buf)
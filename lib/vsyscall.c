@@ -0,0 +1,22 @@
+/*
+ *  linux/lib/vsyscall.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <linux/vtime.h>
+
+/*
+ * _syscallN使用的系统调用入口，0表示使用int 0x80
+ */
+long __vsyscall = 0;
+
+/*
+ * exec之后的程序才映射了系统调用入口页
+ */
+void use_vsyscall(void)
+{
+	__vsyscall = VSYSCALL_ADDR;
+}
@@ -25,8 +25,12 @@
 #include <linux/sched.h>
 #include <linux/head.h>
 #include <linux/kernel.h>
+#include <linux/time.h>
+#include <linux/vtime.h>
+#include <asm/spinlock.h>
 
 void do_exit(long code);
+extern unsigned long vsyscall_page[];
 
 static inline void oom(void)
 {
@@ -34,8 +38,15 @@ static inline void oom(void)
 	do_exit(SIGSEGV);
 }
 
+#ifdef CONFIG_SMP
+/*
+ * 其他CPU上可能运行着共享这些页的进程，需要刷新所有CPU的TLB
+ */
+#define invalidate() smp_flush_tlb()
+#else
 #define invalidate() \
 __asm__ __volatile__("movl %%cr3,%%eax\n\tmovl %%eax,%%cr3":::"ax")
+#endif
 
 
 /* these are not to be changed without changing head.s etc */
@@ -71,6 +82,10 @@ static unsigned long HIGH_MEMORY = 0;
 static unsigned long LOW_MEMORY = 0;
 static unsigned long available_pages = 0;
 static unsigned char mem_map [ PAGING_PAGES ] = {0,};
+/*
+ * 保护mem_map，单处理器时为空
+ */
+static spinlock_t mem_map_lock = SPIN_LOCK_UNLOCKED;
 
 /* chenwg
  * 复制一页4KB的内存
@@ -103,6 +118,7 @@ unsigned long get_free_page(void)
 #ifdef LINUX_ORG
 register unsigned long __res asm("ax");
 
+	spin_lock(&mem_map_lock);
 	__asm__("std ; repne ; scasb\n\t"	//方向位置位
 		"jne 1f\n\t"
 		"movb $1,1(%%edi)\n\t"
@@ -117,11 +133,13 @@ register unsigned long __res asm("ax");
 		:"=a" (__res)
 		:"0" (0), "i" (0), "c" (PAGING_PAGES), "D" (mem_map+PAGING_PAGES-1)
 	);
+	spin_unlock(&mem_map_lock);
 	return __res;
 #else
 	unsigned long j = 0;
 	unsigned long i = MAP_NR(LOW_MEMORY);
 
+	spin_lock(&mem_map_lock);
 	while(i < PAGING_PAGES) {
 		/*
 		 * 如果是保留页或者页计数不为0
@@ -134,6 +152,7 @@ register unsigned long __res asm("ax");
 		 * 设置页计数为1
 		 */
 		mem_map[i] = 1;
+		spin_unlock(&mem_map_lock);
 		/*
 		 * 将页编号转换为物理地址
 		 */
@@ -151,6 +170,7 @@ register unsigned long __res asm("ax");
 		}
 		return i;
 	}
+	spin_unlock(&mem_map_lock);
 	return 0;
 #endif
 }
@@ -176,10 +196,13 @@ void free_page(unsigned long addr)
 	 * 如果内存计数不为0，则减去一次计数，此时释放成功
 	 * 否则panic
 	 */
+	spin_lock(&mem_map_lock);
 	if (mem_map[MAP_NR(addr)]) {
 		mem_map[MAP_NR(addr)]--;
+		spin_unlock(&mem_map_lock);
 		return;	
 	}
+	spin_unlock(&mem_map_lock);
 	panic("trying to free free page");
 	return;
 }
@@ -476,30 +499,18 @@ int copy_page_tables(struct task_struct * tsk)
  * 这个函数的目的是将虚拟地址address映射到物理地址page上
  * 
  */
-unsigned long put_page(unsigned long page, unsigned long address)
+/*
+ * 返回当前进程中address对应的页表项，页表不存在时分配一个
+ */
+static unsigned long * get_pte(unsigned long address)
 {
 	unsigned long tmp, *page_table;
-	struct task_struct *tsk = current;
-
-	/* NOTE !!! This uses the fact that _pg_dir=0 */
-
-	/*
-	 * 如果物理地址page大于系统最大内存，返回错误
-	 */
-	if (page >= HIGH_MEMORY)
-		printk("put_dirty_page: trying to put page %p at %p\n",page,address);
-	
-	/*
-	 * 只有新获取的内存页才能被映射
-	 */
-	if (mem_map[MAP_NR(page)] != 1)
-		printk("mem_map disagrees with %p at %p\n",page,address);
 
 	/*
 	 * (address>>20) & 0xffc) 可以得出address对应的页表目录项
 	 * 然后加上CR0基地址就是页表目录项的地址
 	 */	
-	page_table = (unsigned long *) (tsk->tss.cr3 + ((address>>20) & 0xffc));
+	page_table = (unsigned long *) (current->tss.cr3 + ((address>>20) & 0xffc));
 	
 	/*
 	 * 如果此页表目录项有效则根据页表目录项内容获取页表的地址
@@ -510,7 +521,7 @@ unsigned long put_page(unsigned long page, unsigned long address)
 		page_table = (unsigned long *) (0xfffff000 & *page_table);
 	} else {
 		if (!(tmp=get_free_page())) {
-			return 0;
+			return NULL;
 		}
 		*page_table = tmp | PAGE_ACCESSED |7;
 		page_table = (unsigned long *) tmp;
@@ -518,11 +529,49 @@ unsigned long put_page(unsigned long page, unsigned long address)
 	/*
 	 * page_table已经是页表的地址了
 	 * address >> PAGE_SHIFT 获取address在页中的偏移
-	 * 下面语句执行完毕后page_table就是address对应的页表项
+	 */
+	return page_table + ((address >> PAGE_SHIFT) & 0x3ff);
+}
+
+/*
+ * 将共享时间页和系统调用入口页只读映射到当前进程的VTIME_ADDR处，exec时调用
+ */
+void put_time_page(void)
+{
+	unsigned long * page_table;
+
+	if (!(page_table = get_pte(VTIME_ADDR)))
+		return;
+	*page_table = (unsigned long) time_page | PAGE_USER | PAGE_PRESENT;
+	if (!(page_table = get_pte(VSYSCALL_ADDR)))
+		return;
+	*page_table = (unsigned long) vsyscall_page | PAGE_USER | PAGE_PRESENT;
+}
+
+unsigned long put_page(unsigned long page, unsigned long address)
+{
+	unsigned long *page_table;
+
+	/* NOTE !!! This uses the fact that _pg_dir=0 */
+
+	/*
+	 * 如果物理地址page大于系统最大内存，返回错误
+	 */
+	if (page >= HIGH_MEMORY)
+		printk("put_dirty_page: trying to put page %p at %p\n",page,address);
+	
+	/*
+	 * 只有新获取的内存页才能被映射
+	 */
+	if (mem_map[MAP_NR(page)] != 1)
+		printk("mem_map disagrees with %p at %p\n",page,address);
+
+	/*
 	 * 如果address对应的页表项有内容，打印错误并重新映射到page上
 	 * 最后返回物理地址
 	 */
-	page_table += (address >> PAGE_SHIFT) & 0x3ff;
+	if (!(page_table = get_pte(address)))
+		return 0;
 	if (*page_table) {
 		printk("put_dirty_page: page already exists\n");
 		*page_table = 0;
@@ -549,6 +598,13 @@ void un_wp_page(unsigned long * table_entry)
 	 */
 	old_page = 0xfffff000 & *table_entry;
 
+	/*
+	 * 共享时间页和系统调用入口页是只读的
+	 */
+	if (old_page == (unsigned long) time_page ||
+	    old_page == (unsigned long) vsyscall_page)
+		do_exit(SIGSEGV);
+
 	if (!(mem_map[MAP_NR(old_page)] & USED) && mem_map[MAP_NR(old_page)] == 1) {
 		*table_entry |= PAGE_RW;
 		invalidate();
@@ -25,12 +25,19 @@ page_fault:
 	movl %cr2,%edx
 	pushl %edx
 	pushl %eax
+.ifdef CONFIG_SMP
+	call lock_kernel
+	movl (%esp),%eax		# error code
+.endif
 	testl $1,%eax
 	jne 1f
 	call do_no_page
 	jmp 2f
 1:	call do_wp_page
 2:	addl $8,%esp
+.ifdef CONFIG_SMP
+	call unlock_kernel
+.endif
 	pop %fs
 	pop %es
 	pop %ds
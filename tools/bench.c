@@ -0,0 +1,113 @@
+/*
+ * bench.c -- 内核性能测试，在0.11的根文件系统中用gcc编译运行
+ *
+ * 用法: bench [loops]
+ *
+ * 复制到硬盘映像中(例如在宿主机上mount映像的分区)，然后在0.11中
+ *	gcc -o bench bench.c
+ *
+ * fork扩展性：同时fork 1,2,4,8个只做计算的进程，等待全部结束，
+ * 比较经过的时钟滴答数。make SMP=1的内核上进程数不超过CPU数时
+ * 时间应该基本不变，单处理器内核上和进程数成正比
+ * 0.11的make不能并行，所以不测试并行编译
+ *
+ * 空系统调用的延迟：分别用int 0x80和系统调用入口页调用getpid，
+ * 用rdtsc计算每次调用的时钟周期数。CPU支持时入口页使用sysenter，
+ * 否则入口页也是int 0x80，两者的差就是一次call/ret，启动信息中有
+ * "vsyscall: sysenter"或者"vsyscall: int 0x80"
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+
+#define HZ	100
+#define VSYSCALL_ADDR	0xBF001000	/* 和include/linux/vtime.h一致 */
+#define NR_getpid	20
+#define CALLS		100000
+
+static int loops = 20000000;
+
+static void worker(void)
+{
+	volatile int i;
+
+	for (i = 0 ; i < loops ; i++)
+		;
+	_exit(0);
+}
+
+static void bench_fork(void)
+{
+	struct tms tms;
+	int start, ticks, n, i, status;
+
+	for (n = 1 ; n <= 8 ; n <<= 1) {
+		start = (int) times(&tms);
+		for (i = 0 ; i < n ; i++)
+			if (!fork())
+				worker();
+		for (i = 0 ; i < n ; i++)
+			wait(&status);
+		ticks = (int) times(&tms) - start;
+		printf("fork: %d workers, %d ticks (%d ms)\n",
+			n, ticks, ticks * 1000 / HZ);
+	}
+}
+
+/*
+ * 只取低32位，CALLS次调用不会溢出
+ */
+static unsigned long rdtsc(void)
+{
+	unsigned long lo, hi;
+
+	__asm__ __volatile__(".byte 0x0f,0x31":"=a" (lo),"=d" (hi));
+	return lo;
+}
+
+static int getpid_int80(void)
+{
+	int res;
+
+	__asm__ __volatile__("int $0x80":"=a" (res):"0" (NR_getpid));
+	return res;
+}
+
+static int getpid_vsyscall(void)
+{
+	int res;
+
+	__asm__ __volatile__("call *%1":"=a" (res)
+		:"r" (VSYSCALL_ADDR),"0" (NR_getpid):"memory");
+	return res;
+}
+
+static void bench_getpid(void)
+{
+	unsigned long start, int80, vsys;
+	int i;
+
+	getpid_int80();
+	getpid_vsyscall();
+	start = rdtsc();
+	for (i = 0 ; i < CALLS ; i++)
+		getpid_int80();
+	int80 = rdtsc() - start;
+	start = rdtsc();
+	for (i = 0 ; i < CALLS ; i++)
+		getpid_vsyscall();
+	vsys = rdtsc() - start;
+	printf("getpid: int 0x80 %d cycles, vsyscall %d cycles\n",
+		(int) (int80 / CALLS), (int) (vsys / CALLS));
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc > 1)
+		loops = atoi(argv[1]);
+	bench_getpid();
+	bench_fork();
+	return 0;
+}
@@ -20,6 +20,20 @@ dd if=$setup seek=1 bs=512 count=4 of=$image >/dev/null 2>&1
 
 # Write kernel (< SYS_SIZE), see the hardcoded SYSSIZE in src/boot/bootsetc.s
 [ ! -f "$kernel" ] && echo "Error: No kernel binary file there" && exit -1
+
+# bootsect loads SYSSIZE clicks (16 bytes) and may read up to one more track
+# (18 sectors), all of which must end before the ramdisk at RAMDISK_START KB
+syssize=$(sed -n 's/^[[:space:]]*\.equ[[:space:]]*SYSSIZE,[[:space:]]*\(0x[0-9a-fA-F]*\).*/\1/p' ${bootsect}.s)
+kernel_size=$(wc -c < $kernel)
+if [ -n "$syssize" ] && [ $kernel_size -gt $((syssize * 16)) ]; then
+	echo "Error: kernel is $kernel_size bytes, bootsect loads only $((syssize * 16)) (SYSSIZE)"
+	exit -1
+fi
+if [ -n "$syssize" ] && [ -n "$RAMDISK_START" ] &&
+   [ $((5 * 512 + syssize * 16 + 18 * 512)) -gt $((RAMDISK_START * 1024)) ]; then
+	echo "Error: SYSSIZE reaches the ramdisk at ${RAMDISK_START}KB"
+	exit -1
+fi
 dd if=$kernel seek=5 bs=512 of=$image >/dev/null 2>&1
 
 # Write ramdisk
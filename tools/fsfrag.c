@@ -0,0 +1,208 @@
+/*
+ * fsfrag.c -- 报告MINIX文件系统映像的碎片情况，在宿主机上运行
+ *
+ * 用法: fsfrag [-v] [-p 分区号] image
+ *   -v 列出每个不连续的文件
+ *   -p 映像是带分区表的硬盘时，指定分区(1-4)
+ *
+ * 文件的数据块(不包括间接块)按文件中的顺序，块号不连续一次算一个片段
+ * 空闲空间按逻辑块位图中连续为0的段统计
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE	1024
+#define SUPER_MAGIC	0x137F
+#define S_IFMT		0170000
+#define S_IFREG		0100000
+#define S_IFDIR		0040000
+
+struct d_super_block {
+	unsigned short s_ninodes;
+	unsigned short s_nzones;
+	unsigned short s_imap_blocks;
+	unsigned short s_zmap_blocks;
+	unsigned short s_firstdatazone;
+	unsigned short s_log_zone_size;
+	unsigned int s_max_size;
+	unsigned short s_magic;
+};
+
+struct d_inode {
+	unsigned short i_mode;
+	unsigned short i_uid;
+	unsigned int i_size;
+	unsigned int i_time;
+	unsigned char i_gid;
+	unsigned char i_nlinks;
+	unsigned short i_zone[9];
+};
+
+static FILE * img;
+static long fs_offset = 0;
+static struct d_super_block sb;
+
+/*
+ * 一个文件的片段统计，last为上一个数据块
+ */
+static unsigned int nr_blocks, nr_extents, last;
+
+static void read_block(int block, void * buf)
+{
+	if (fseek(img, fs_offset + (long) block * BLOCK_SIZE, SEEK_SET) ||
+	    fread(buf, BLOCK_SIZE, 1, img) != 1) {
+		fprintf(stderr, "fsfrag: cannot read block %d\n", block);
+		exit(1);
+	}
+}
+
+static void add_block(unsigned int block)
+{
+	if (!block)
+		return;
+	if (!nr_blocks || block != last + 1)
+		nr_extents++;
+	nr_blocks++;
+	last = block;
+}
+
+/*
+ * level为0时block是数据块，否则是间接块
+ */
+static void walk(unsigned int block, int level)
+{
+	unsigned short buf[BLOCK_SIZE/2];
+	int i;
+
+	if (!block)
+		return;
+	if (!level) {
+		add_block(block);
+		return;
+	}
+	if (block >= sb.s_nzones)
+		return;
+	read_block(block, buf);
+	for (i = 0 ; i < BLOCK_SIZE/2 ; i++)
+		walk(buf[i], level - 1);
+}
+
+/*
+ * 从MBR中读取分区的起始扇区
+ */
+static long partition_offset(int nr)
+{
+	unsigned char mbr[512];
+	unsigned char * p;
+
+	if (fseek(img, 0, SEEK_SET) || fread(mbr, 512, 1, img) != 1 ||
+	    mbr[510] != 0x55 || mbr[511] != 0xAA) {
+		fprintf(stderr, "fsfrag: bad partition table\n");
+		exit(1);
+	}
+	p = mbr + 0x1BE + (nr - 1) * 16;
+	return (long) (p[8] | p[9] << 8 | p[10] << 16 | (unsigned) p[11] << 24) * 512;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned char buf[BLOCK_SIZE];
+	struct d_inode * inodes;
+	unsigned char * zmap;
+	unsigned int files = 0, frag_files = 0, blocks = 0, extents = 0;
+	unsigned int free_blocks = 0, free_extents = 0, run = 0, max_run = 0;
+	int verbose = 0, part = 0, c, i, nr, nbits;
+
+	while ((c = getopt(argc, argv, "vp:")) != -1) {
+		switch (c) {
+			case 'v': verbose = 1; break;
+			case 'p': part = atoi(optarg); break;
+			default: goto usage;
+		}
+	}
+	if (optind != argc - 1 || part < 0 || part > 4)
+		goto usage;
+	if (!(img = fopen(argv[optind], "rb"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (part)
+		fs_offset = partition_offset(part);
+	read_block(1, buf);
+	memcpy(&sb, buf, sizeof (sb));
+	if (sb.s_magic != SUPER_MAGIC) {
+		fprintf(stderr, "fsfrag: not a minix filesystem\n");
+		return 1;
+	}
+
+	/*
+	 * 文件和目录的数据块
+	 */
+	nr = (sb.s_ninodes + BLOCK_SIZE / sizeof (struct d_inode) - 1) /
+		(BLOCK_SIZE / sizeof (struct d_inode));
+	inodes = malloc(nr * BLOCK_SIZE);
+	zmap = malloc(sb.s_zmap_blocks * BLOCK_SIZE);
+	if (!inodes || !zmap) {
+		fprintf(stderr, "fsfrag: out of memory\n");
+		return 1;
+	}
+	for (i = 0 ; i < nr ; i++)
+		read_block(2 + sb.s_imap_blocks + sb.s_zmap_blocks + i,
+			(char *) inodes + i * BLOCK_SIZE);
+	for (i = 0 ; i < sb.s_ninodes ; i++) {
+		struct d_inode * ip = inodes + i;
+
+		if (!ip->i_nlinks || ((ip->i_mode & S_IFMT) != S_IFREG &&
+		    (ip->i_mode & S_IFMT) != S_IFDIR))
+			continue;
+		nr_blocks = nr_extents = 0;
+		for (c = 0 ; c < 7 ; c++)
+			walk(ip->i_zone[c], 0);
+		walk(ip->i_zone[7], 1);
+		walk(ip->i_zone[8], 2);
+		files++;
+		blocks += nr_blocks;
+		extents += nr_extents;
+		if (nr_extents > 1) {
+			frag_files++;
+			if (verbose)
+				printf("inode %5d: %6u blocks, %4u extents\n",
+					i + 1, nr_blocks, nr_extents);
+		}
+	}
+
+	/*
+	 * 空闲空间，bit0保留
+	 */
+	for (i = 0 ; i < sb.s_zmap_blocks ; i++)
+		read_block(2 + sb.s_imap_blocks + i, zmap + i * BLOCK_SIZE);
+	nbits = sb.s_nzones - sb.s_firstdatazone + 1;
+	for (i = 1 ; i <= nbits ; i++) {
+		if (i < nbits && !(zmap[i >> 3] & (1 << (i & 7)))) {
+			free_blocks++;
+			run++;
+			continue;
+		}
+		if (run) {
+			free_extents++;
+			if (run > max_run)
+				max_run = run;
+		}
+		run = 0;
+	}
+
+	printf("files:        %u, %u fragmented (%u%%)\n", files, frag_files,
+		files ? frag_files * 100 / files : 0);
+	printf("data blocks:  %u in %u extents, %u.%02u blocks per extent\n",
+		blocks, extents, extents ? blocks / extents : 0,
+		extents ? blocks % extents * 100 / extents : 0);
+	printf("free blocks:  %u in %u extents, largest %u\n",
+		free_blocks, free_extents, max_run);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: fsfrag [-v] [-p partition] image\n");
+	return 1;
+}